@@ -7,9 +7,16 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_string.h>
 
+#define ECALL_BENCH_ITERS	1024
+#define MISALIGNED_BENCH_ITERS	256
+#define MISALIGNED_AUTO_ITERS	1000000
+#define CONSOLE_BENCH_BYTES	2048
+#define CONSOLE_BENCH_LINE	64
+
 struct sbiret {
 	unsigned long error;
 	unsigned long value;
@@ -40,10 +47,24 @@ struct sbiret sbi_ecall(int ext, int fid, unsigned long arg0,
 	return ret;
 }
 
+static void sbi_ecall_console_write(const char *str, unsigned long len)
+{
+	struct sbiret ret;
+
+	/* The firmware may write only part of the string */
+	while (len) {
+		ret = sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE,
+				len, (unsigned long)str, 0, 0, 0, 0);
+		if (ret.error)
+			break;
+		str += ret.value;
+		len -= ret.value;
+	}
+}
+
 static inline void sbi_ecall_console_puts(const char *str)
 {
-	sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE,
-		  sbi_strlen(str), (unsigned long)str, 0, 0, 0, 0);
+	sbi_ecall_console_write(str, sbi_strlen(str));
 }
 
 #define wfi()                                             \
@@ -51,10 +72,304 @@ static inline void sbi_ecall_console_puts(const char *str)
 		__asm__ __volatile__("wfi" ::: "memory"); \
 	} while (0)
 
+static void test_puts_ulong(unsigned long val)
+{
+	char buf[24];
+	int pos = sizeof(buf) - 1;
+
+	buf[pos] = '\0';
+	do {
+		buf[--pos] = '0' + (val % 10);
+		val /= 10;
+	} while (val && pos);
+
+	sbi_ecall_console_puts(&buf[pos]);
+}
+
+/* Average time ticks per ecall scaled by 100 */
+static unsigned long test_ecall_bench(int ext, int fid, unsigned long arg0,
+				      unsigned long arg1)
+{
+	unsigned long start;
+	int i;
+
+	start = csr_read(CSR_TIME);
+	for (i = 0; i < ECALL_BENCH_ITERS; i++)
+		sbi_ecall(ext, fid, arg0, arg1, 0, 0, 0, 0);
+
+	return (csr_read(CSR_TIME) - start) * 100 / ECALL_BENCH_ITERS;
+}
+
+static void test_ecall_bench_print(const char *name, int ext, int fid,
+				   unsigned long arg0, unsigned long arg1)
+{
+	unsigned long ticks = test_ecall_bench(ext, fid, arg0, arg1);
+
+	sbi_ecall_console_puts(name);
+	sbi_ecall_console_puts(": ");
+	test_puts_ulong(ticks / 100);
+	sbi_ecall_console_puts(ticks % 100 < 10 ? ".0" : ".");
+	test_puts_ulong(ticks % 100);
+	sbi_ecall_console_puts(" ticks per ecall\n");
+}
+
+/*
+ * Round trip latency of ecalls with trivial handlers, so mostly the
+ * trap entry/exit and extension lookup cost, in time CSR ticks. The
+ * TIME, IPI, RFENCE and PMU counter_fw_read calls take the fast ecall
+ * path when the firmware has CONFIG_SBI_ECALL_FAST_PATH.
+ */
+static void test_ecall_latency(void)
+{
+	sbi_ecall_console_puts("\nEcall latency:\n");
+	test_ecall_bench_print("base get_spec_version", SBI_EXT_BASE,
+			       SBI_EXT_BASE_GET_SPEC_VERSION, 0, 0);
+	test_ecall_bench_print("base probe_extension", SBI_EXT_BASE,
+			       SBI_EXT_BASE_PROBE_EXT, SBI_EXT_TIME, 0);
+	test_ecall_bench_print("time set_timer", SBI_EXT_TIME,
+			       SBI_EXT_TIME_SET_TIMER, -1UL, -1UL);
+	test_ecall_bench_print("pmu num_counters", SBI_EXT_PMU,
+			       SBI_EXT_PMU_NUM_COUNTERS, 0, 0);
+	test_ecall_bench_print("pmu counter_fw_read", SBI_EXT_PMU,
+			       SBI_EXT_PMU_COUNTER_FW_READ, 0, 0);
+	test_ecall_bench_print("ipi send_ipi (no harts)", SBI_EXT_IPI,
+			       SBI_EXT_IPI_SEND_IPI, 0, 0);
+	test_ecall_bench_print("rfence fence_i (no harts)", SBI_EXT_RFENCE,
+			       SBI_EXT_RFENCE_REMOTE_FENCE_I, 0, 0);
+	test_ecall_bench_print("unknown extension", 0x12345678, 0, 0, 0);
+}
+
+/*
+ * Round trip latency of a trivial ecall with the vector registers in
+ * the Initial and in the Dirty state. Traps leave the vector registers
+ * alone, so dirty vector state should not make ecalls any slower.
+ */
+static void test_vector_ecall_latency(void)
+{
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+	unsigned long vl;
+
+	/* mstatus.VS is read-only zero without the vector extension */
+	csr_set(CSR_SSTATUS, SSTATUS_VS);
+	if (!(csr_read(CSR_SSTATUS) & SSTATUS_VS))
+		return;
+
+	sbi_ecall_console_puts("\nEcall latency with vector state:\n");
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvli %0, x0, e8, m8, ta, ma\n\t"
+		     "vmv.v.i v0, 0\n\t"
+		     "vmv.v.i v8, 0\n\t"
+		     "vmv.v.i v16, 0\n\t"
+		     "vmv.v.i v24, 0\n\t"
+		     ".option pop\n\t"
+		     : "=r"(vl));
+	csr_clear(CSR_SSTATUS, SSTATUS_VS);
+	csr_set(CSR_SSTATUS, MSTATUS_VS_INITIAL);
+	test_ecall_bench_print("vector initial", SBI_EXT_BASE,
+			       SBI_EXT_BASE_GET_SPEC_VERSION, 0, 0);
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvli %0, x0, e8, m8, ta, ma\n\t"
+		     "vmv.v.i v0, 1\n\t"
+		     ".option pop\n\t"
+		     : "=r"(vl));
+	test_ecall_bench_print("vector dirty", SBI_EXT_BASE,
+			       SBI_EXT_BASE_GET_SPEC_VERSION, 0, 0);
+#endif
+}
+
+/*
+ * Latency of switching domain contexts through the OpenSBI firmware
+ * extension. Without a second domain to bounce to, the root domain
+ * enters and exits itself, which still saves and restores the whole
+ * context on each call. Needs CONFIG_SBI_ECALL_OPENSBI_DOMAIN.
+ */
+static void test_domain_switch_latency(void)
+{
+	static unsigned long args[256 / sizeof(unsigned long)];
+	struct sbiret ret;
+
+	ret = sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_DOMAIN_ENTER,
+			0, 0, 0, 0, 0, 0);
+	if (ret.error)
+		return;
+
+	sbi_ecall_console_puts("\nDomain context switch latency:\n");
+	test_ecall_bench_print("domain enter", SBI_EXT_OPENSBI,
+			       SBI_EXT_OPENSBI_DOMAIN_ENTER, 0, 0);
+	test_ecall_bench_print("domain exit", SBI_EXT_OPENSBI,
+			       SBI_EXT_OPENSBI_DOMAIN_EXIT, 0, 0);
+
+	ret = sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_DOMAIN_SET_ARGS,
+			(unsigned long)args, 0, sizeof(args), 0, 0, 0);
+	if (ret.error)
+		return;
+
+	test_ecall_bench_print("domain enter (256 byte args)", SBI_EXT_OPENSBI,
+			       SBI_EXT_OPENSBI_DOMAIN_ENTER, 0, 0);
+	sbi_ecall(SBI_EXT_OPENSBI, SBI_EXT_OPENSBI_DOMAIN_SET_ARGS,
+		  0, 0, 0, 0, 0, 0);
+}
+
+void test_sse_handler(void);
+
+static volatile unsigned long test_sse_fired;
+
+/*
+ * Take misaligned load traps back to back until the firmware either
+ * raises the misaligned rate SSE event or delegates misaligned
+ * exceptions, and report after how many traps that happened. Misaligned
+ * delegation is then locked off so that the emulation benchmark below
+ * keeps running in M-mode.
+ */
+static void test_misaligned_auto(void)
+{
+	static unsigned long buf[2];
+	volatile unsigned long *p = (void *)((char *)buf + 1);
+	unsigned long i, start, ticks;
+	struct sbiret ret;
+	bool sse;
+
+	sbi_ecall_console_puts("\nMisaligned trap rate handoff:\n");
+
+	ret = sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_GET,
+			SBI_FWFT_MISALIGNED_EXC_DELEG, 0, 0, 0, 0, 0);
+	if (ret.error || ret.value) {
+		sbi_ecall_console_puts("misaligned delegation not controllable\n");
+		return;
+	}
+
+	ret = sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_REGISTER,
+			SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE,
+			(unsigned long)test_sse_handler,
+			(unsigned long)&test_sse_fired, 0, 0, 0);
+	sse = !ret.error;
+	if (sse) {
+		sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_ENABLE,
+			  SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE, 0, 0, 0, 0, 0);
+		sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_HART_UNMASK,
+			  0, 0, 0, 0, 0, 0);
+	}
+
+	start = csr_read(CSR_TIME);
+	for (i = 0; i < MISALIGNED_AUTO_ITERS; i++) {
+		(void)*p;
+		if (test_sse_fired)
+			break;
+
+		/* Stop before the next access would trap into S-mode */
+		ret = sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_GET,
+				SBI_FWFT_MISALIGNED_EXC_DELEG, 0, 0, 0, 0, 0);
+		if (ret.value)
+			break;
+	}
+	ticks = csr_read(CSR_TIME) - start;
+
+	if (test_sse_fired)
+		sbi_ecall_console_puts("SSE event raised after ");
+	else if (i < MISALIGNED_AUTO_ITERS)
+		sbi_ecall_console_puts("misaligned exceptions delegated after ");
+	else
+		sbi_ecall_console_puts("no handoff after ");
+	test_puts_ulong(i + 1);
+	sbi_ecall_console_puts(" accesses in ");
+	test_puts_ulong(ticks);
+	sbi_ecall_console_puts(" ticks\n");
+
+	if (sse) {
+		sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_DISABLE,
+			  SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE, 0, 0, 0, 0, 0);
+		sbi_ecall(SBI_EXT_SSE, SBI_EXT_SSE_UNREGISTER,
+			  SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE, 0, 0, 0, 0, 0);
+	}
+	sbi_ecall(SBI_EXT_FWFT, SBI_EXT_FWFT_SET,
+		  SBI_FWFT_MISALIGNED_EXC_DELEG, 0, SBI_FWFT_SET_FLAG_LOCK,
+		  0, 0, 0);
+}
+
+/*
+ * Average time ticks per misaligned XLEN load and store.
+ * On harts without hardware support these trap into the firmware and
+ * measure its emulation.
+ */
+static void test_misaligned_latency(void)
+{
+	static unsigned long buf[4];
+	volatile unsigned long *p = (void *)((char *)buf + 3);
+	unsigned long start, ticks, val = 0;
+	int i;
+
+	sbi_ecall_console_puts("\nMisaligned access latency:\n");
+
+	start = csr_read(CSR_TIME);
+	for (i = 0; i < MISALIGNED_BENCH_ITERS; i++)
+		val += *p;
+	ticks = (csr_read(CSR_TIME) - start) / MISALIGNED_BENCH_ITERS;
+	sbi_ecall_console_puts("load: ");
+	test_puts_ulong(ticks);
+	sbi_ecall_console_puts(" ticks\n");
+
+	start = csr_read(CSR_TIME);
+	for (i = 0; i < MISALIGNED_BENCH_ITERS; i++)
+		*p = val + i;
+	ticks = (csr_read(CSR_TIME) - start) / MISALIGNED_BENCH_ITERS;
+	sbi_ecall_console_puts("store: ");
+	test_puts_ulong(ticks);
+	sbi_ecall_console_puts(" ticks\n");
+}
+
+/*
+ * Time ticks to write a large buffer of text lines through the debug
+ * console, once with a single write and once a byte per ecall.
+ */
+static void test_console_throughput(void)
+{
+	static char buf[CONSOLE_BENCH_BYTES];
+	unsigned long start, ticks[2];
+	int i;
+
+	for (i = 0; i < CONSOLE_BENCH_BYTES; i++) {
+		if (i % CONSOLE_BENCH_LINE == CONSOLE_BENCH_LINE - 1)
+			buf[i] = '\n';
+		else
+			buf[i] = '!' + i % CONSOLE_BENCH_LINE;
+	}
+
+	sbi_ecall_console_puts("\nConsole throughput:\n");
+
+	start = csr_read(CSR_TIME);
+	sbi_ecall_console_write(buf, CONSOLE_BENCH_BYTES);
+	ticks[0] = csr_read(CSR_TIME) - start;
+
+	start = csr_read(CSR_TIME);
+	for (i = 0; i < CONSOLE_BENCH_BYTES; i++)
+		sbi_ecall(SBI_EXT_DBCN, SBI_EXT_DBCN_CONSOLE_WRITE_BYTE,
+			  buf[i], 0, 0, 0, 0, 0);
+	ticks[1] = csr_read(CSR_TIME) - start;
+
+	sbi_ecall_console_puts("write: ");
+	test_puts_ulong(ticks[0]);
+	sbi_ecall_console_puts(" ticks, write_byte: ");
+	test_puts_ulong(ticks[1]);
+	sbi_ecall_console_puts(" ticks for ");
+	test_puts_ulong(CONSOLE_BENCH_BYTES);
+	sbi_ecall_console_puts(" bytes\n");
+}
+
 void test_main(unsigned long a0, unsigned long a1)
 {
 	sbi_ecall_console_puts("\nTest payload running\n");
 
+	test_ecall_latency();
+	test_vector_ecall_latency();
+	test_domain_switch_latency();
+	test_misaligned_auto();
+	test_misaligned_latency();
+	test_console_throughput();
+
 	while (1)
 		wfi();
 }
@@ -24,8 +24,10 @@
 #define MSTATUS_MPP_SHIFT		11
 #define MSTATUS_MPP			(_UL(3) << MSTATUS_MPP_SHIFT)
 #define MSTATUS_FS			_UL(0x00006000)
+#define MSTATUS_FS_INITIAL		_UL(0x00002000)
 #define MSTATUS_XS			_UL(0x00018000)
 #define MSTATUS_VS			_UL(0x00000600)
+#define MSTATUS_VS_INITIAL		_UL(0x00000200)
 #define MSTATUS_MPRV			_UL(0x00020000)
 #define MSTATUS_SUM			_UL(0x00040000)
 #define MSTATUS_MXR			_UL(0x00080000)
@@ -765,6 +767,7 @@
 
 /* Vector extension registers */
 #define CSR_VSTART			0x8
+#define CSR_VCSR			0xf
 #define CSR_VL				0xc20
 #define CSR_VTYPE			0xc21
 #define CSR_VLENB			0xc22
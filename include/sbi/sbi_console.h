@@ -12,6 +12,8 @@
 
 #include <sbi/sbi_types.h>
 
+struct sbi_scratch;
+
 struct sbi_console_device {
 	/** Name of the console device */
 	char name[32];
@@ -56,7 +58,18 @@ const struct sbi_console_device *sbi_console_get_device(void);
 
 void sbi_console_set_device(const struct sbi_console_device *dev);
 
-struct sbi_scratch;
+#ifdef CONFIG_CONSOLE_ASYNC
+/** Heap space needed per HART for buffering console output */
+#define SBI_CONSOLE_HART_SIZE	(CONFIG_CONSOLE_ASYNC_RING_SIZE + 512)
+#endif
+
+/** Write out buffered console output as far as possible without waiting */
+void sbi_console_drain(void);
+
+/** Write out all buffered console output */
+void sbi_console_flush(void);
+
+int sbi_console_init(struct sbi_scratch *scratch, bool cold_boot);
 
 #define SBI_ASSERT(cond, args) do { \
 	if (unlikely(!(cond))) \
@@ -160,6 +160,16 @@ struct sbi_domain_memregion {
 	unsigned long flags;
 };
 
+/** Address interval of a domain with the same effective access */
+struct sbi_domain_memrange {
+	/** Start of the interval which ends where the next one starts */
+	unsigned long base;
+	/** Flags of the memory region deciding accesses in the interval */
+	unsigned long flags;
+	/** Is the interval covered by any memory region */
+	bool mapped;
+};
+
 /** Representation of OpenSBI domain */
 struct sbi_domain {
 	/** Node in linked list of domains */
@@ -178,6 +188,10 @@ struct sbi_domain {
 	const struct sbi_hartmask *possible_harts;
 	/** Array of memory regions terminated by a region with order zero */
 	struct sbi_domain_memregion *regions;
+	/** Address sorted intervals of memory regions built on finalize */
+	struct sbi_domain_memrange *ranges;
+	/** Number of entries in the interval array */
+	u32 range_count;
 	/** HART id of the HART booting this domain */
 	u32 boot_hartid;
 	/** Arg1 (or 'a1' register) of next booting stage for this domain */
@@ -28,6 +28,20 @@ int sbi_domain_context_enter(struct sbi_domain *dom);
  */
 int sbi_domain_context_exit(void);
 
+/** Maximum size of the argument shared memory of a domain context */
+#define SBI_DOMAIN_CONTEXT_ARGS_MAX	4096
+
+/**
+ * Set the argument shared memory of the current domain on this HART.
+ * When switching domain contexts the arguments of the current domain
+ * are copied to those of the target domain, up to the smaller size.
+ * @param addr physical address accessible by the current domain
+ * @param size size in bytes or zero to remove the shared memory
+ *
+ * @return 0 on success and negative error code on failure
+ */
+int sbi_domain_context_set_args(unsigned long addr, unsigned long size);
+
 /**
  * Initialize domain context support
  *
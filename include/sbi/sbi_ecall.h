@@ -15,7 +15,6 @@
 
 #define SBI_ECALL_VERSION_MAJOR		2
 #define SBI_ECALL_VERSION_MINOR		0
-#define SBI_OPENSBI_IMPID		1
 
 struct sbi_trap_regs;
 struct sbi_trap_context;
@@ -95,6 +94,15 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext);
 
 int sbi_ecall_handler(struct sbi_trap_context *tcntx);
 
+/**
+ * Handle a hot S-mode ecall from the trap vector with only the GPRs the
+ * C calling convention may clobber, mepc and mstatus saved in regs.
+ *
+ * @return regs if the call was handled and NULL if the full trap path
+ * has to handle it, in which case no CSR or trap state was touched
+ */
+struct sbi_trap_regs *sbi_ecall_fast_handler(struct sbi_trap_regs *regs);
+
 int sbi_ecall_init(void);
 
 #endif
@@ -38,6 +38,8 @@
 #define SBI_EXT_SSE				0x535345
 #define SBI_EXT_FWFT				0x46574654
 #define SBI_EXT_MPXY				0x4D505859
+#define SBI_EXT_OPENSBI				(SBI_EXT_FIRMWARE_START + \
+					 SBI_OPENSBI_IMPID)
 
 /* SBI function IDs for BASE extension*/
 #define SBI_EXT_BASE_GET_SPEC_VERSION		0x0
@@ -236,6 +238,22 @@ enum sbi_pmu_fw_event_code_id {
 	 * Event codes 256 to 65534 are reserved for SBI implementation
 	 * specific custom firmware events.
 	 */
+	SBI_PMU_FW_IMPL_START = 256,
+	/* Ranges received through the OpenSBI batched remote fence call */
+	SBI_PMU_FW_RFENCE_BATCH_RANGES = SBI_PMU_FW_IMPL_START,
+	/* Batched ranges merged into another range before being sent */
+	SBI_PMU_FW_RFENCE_BATCH_COALESCED,
+	/* Remote fences merged into or covered by another pending fence */
+	SBI_PMU_FW_TLB_COALESCED,
+	/* Pending remote fences upgraded to an ASID, VMID or full flush */
+	SBI_PMU_FW_TLB_FLUSH_PROMOTED,
+	/* Remote FENCE.I requests folded into a pending FENCE.I */
+	SBI_PMU_FW_FENCE_I_COALESCED,
+	/* Shared memory mapped with a PMP entry which was already live */
+	SBI_PMU_FW_SADDR_CACHE_HIT,
+	/* Shared memory mapped by programming a PMP entry */
+	SBI_PMU_FW_SADDR_CACHE_MISS,
+	SBI_PMU_FW_IMPL_MAX,
 	SBI_PMU_FW_RESERVED_MAX = 0xFFFE,
 	/*
 	 * Event code 0xFFFF is used for platform specific firmware
@@ -266,6 +284,18 @@ struct sbi_pmu_event_info {
 	uint64_t event_data;
 };
 
+/** Size and alignment of the PMU snapshot shared memory */
+#define SBI_PMU_SNAPSHOT_SIZE	4096
+
+/** Layout of the PMU snapshot shared memory */
+struct sbi_pmu_snapshot {
+	/* Overflown counters relative to the counter index base */
+	uint64_t ctr_overflow_mask;
+	/* Counter values relative to the counter index base */
+	uint64_t ctr_values[64];
+	uint64_t reserved[447];
+};
+
 /* Helper macros to decode event idx */
 #define SBI_PMU_EVENT_IDX_MASK 0xFFFFF
 #define SBI_PMU_EVENT_IDX_TYPE_OFFSET 16
@@ -419,6 +449,13 @@ enum sbi_sse_state {
 #define SBI_SSE_EVENT_GLOBAL_PLAT_3_START	0xffffc000
 #define SBI_SSE_EVENT_GLOBAL_PLAT_3_END		0xffffffff
 
+/*
+ * OpenSBI specific events. The SSE specification has no firmware range,
+ * so OpenSBI reserves the last IDs of the group 3 platform ranges and
+ * platforms must not use them.
+ */
+#define SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE	SBI_SSE_EVENT_LOCAL_PLAT_3_END
+
 #define SBI_SSE_EVENT_GLOBAL_BIT		(1 << 15)
 #define SBI_SSE_EVENT_PLATFORM_BIT		(1 << 14)
 
@@ -431,6 +468,66 @@ enum sbi_sse_state {
 #define SBI_EXT_MPXY_SEND_MSG_NO_RESP		0x5
 #define SBI_EXT_MPXY_GET_NOTIFICATION_EVENTS	0x6
 
+/* SBI function IDs for OpenSBI firmware extension */
+#define SBI_EXT_OPENSBI_RFENCE_BATCH		0x0
+
+/** Range descriptor in shared memory for SBI_EXT_OPENSBI_RFENCE_BATCH */
+struct sbi_rfence_batch_entry {
+	/* One of the SBI_EXT_RFENCE_REMOTE_* function IDs */
+	unsigned long fid;
+	unsigned long start_addr;
+	unsigned long size;
+	/* ASID or VMID, same as the last argument of the RFENCE call */
+	unsigned long asid_vmid;
+};
+
+#define SBI_EXT_OPENSBI_STATS_SNAPSHOT		0x1
+
+/** Flags of SBI_EXT_OPENSBI_STATS_SNAPSHOT */
+#define SBI_OPENSBI_STATS_RESET			(1UL << 0)
+
+/*
+ * Latency histogram buckets: bucket 0 counts deltas below 32, bucket i
+ * deltas in [2^(i + 4), 2^(i + 5)) and the last bucket everything above.
+ */
+#define SBI_OPENSBI_STATS_BUCKETS		16
+#define SBI_OPENSBI_STATS_BUCKET_SHIFT		5
+
+#define SBI_OPENSBI_STATS_KIND_TRAP		1
+#define SBI_OPENSBI_STATS_KIND_ECALL		2
+
+#define SBI_OPENSBI_STATS_CLOCK_MCYCLE		0
+#define SBI_OPENSBI_STATS_CLOCK_TIME		1
+
+/** Shared memory header written by SBI_EXT_OPENSBI_STATS_SNAPSHOT */
+struct sbi_opensbi_stats_header {
+	/* Number of entries following the header */
+	u32 num_entries;
+	u32 num_buckets;
+	/* One of SBI_OPENSBI_STATS_CLOCK_* */
+	u32 clock;
+	u32 reserved;
+	/* Records dropped because the histogram table was full */
+	u64 dropped;
+};
+
+/** Latency histogram of one trap cause or ecall function */
+struct sbi_opensbi_stats_entry {
+	/* mcause for KIND_TRAP, extension ID for KIND_ECALL */
+	u64 id;
+	/* Function ID for KIND_ECALL */
+	u32 fid;
+	/* One of SBI_OPENSBI_STATS_KIND_* */
+	u32 kind;
+	/* Sum of all deltas */
+	u64 total;
+	u32 buckets[SBI_OPENSBI_STATS_BUCKETS];
+};
+
+#define SBI_EXT_OPENSBI_DOMAIN_ENTER		0x2
+#define SBI_EXT_OPENSBI_DOMAIN_EXIT		0x3
+#define SBI_EXT_OPENSBI_DOMAIN_SET_ARGS		0x4
+
 /* SBI base specification related macros */
 #define SBI_SPEC_VERSION_MAJOR_OFFSET		24
 #define SBI_SPEC_VERSION_MAJOR_MASK		0x7f
@@ -440,6 +537,9 @@ enum sbi_sse_state {
 #define SBI_EXT_FIRMWARE_START			0x0A000000
 #define SBI_EXT_FIRMWARE_END			0x0AFFFFFF
 
+/* SBI implementation IDs */
+#define SBI_OPENSBI_IMPID			1
+
 /* SBI return error codes */
 #define SBI_SUCCESS				0
 #define SBI_ERR_FAILED				-1
@@ -13,6 +13,7 @@
 #include <sbi/sbi_ecall_interface.h>
 
 struct sbi_scratch;
+struct sbi_trap_regs;
 
 int sbi_fwft_set(enum sbi_fwft_feature_t feature, unsigned long value,
 		 unsigned long flags);
@@ -20,4 +21,12 @@ int sbi_fwft_get(enum sbi_fwft_feature_t feature, unsigned long *out_val);
 
 int sbi_fwft_init(struct sbi_scratch *scratch, bool cold_boot);
 
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+void sbi_fwft_misaligned_trap(const struct sbi_trap_regs *regs);
+#else
+static inline void sbi_fwft_misaligned_trap(const struct sbi_trap_regs *regs)
+{
+}
+#endif
+
 #endif
@@ -77,6 +77,8 @@ enum sbi_hart_extensions {
 	SBI_HART_EXT_ZICFISS,
 	/** Hart has Ssdbltrp extension */
 	SBI_HART_EXT_SSDBLTRP,
+	/** Hart has Zbb extension */
+	SBI_HART_EXT_ZBB,
 
 	/** Maximum index of Hart extension */
 	SBI_HART_EXT_MAX,
@@ -101,8 +103,16 @@ extern const struct sbi_hart_ext_data sbi_hart_ext[];
  * permissions to the M-mode. Once the work is done, it should be
  * unmapped. sbi_hart_map_saddr/sbi_hart_unmap_saddr function
  * pair should be used to map/unmap the shared memory.
+ *
+ * When there are more PMP entries than any domain needs, up to
+ * SBI_SMEPMP_SADDR_SLOTS entries starting with the reserved one are
+ * used for mappings. Unmapped entries stay programmed until the HART
+ * returns to S/U-mode or accesses S/U-mode memory through MPRV so that
+ * shared memory mapped repeatedly while handling one trap is programmed
+ * only once.
  */
 #define SBI_SMEPMP_RESV_ENTRY		0
+#define SBI_SMEPMP_SADDR_SLOTS		4
 
 struct sbi_hart_features {
 	bool detected;
@@ -134,8 +144,10 @@ unsigned int sbi_hart_pmp_log2gran(struct sbi_scratch *scratch);
 unsigned int sbi_hart_pmp_addrbits(struct sbi_scratch *scratch);
 unsigned int sbi_hart_mhpm_bits(struct sbi_scratch *scratch);
 int sbi_hart_pmp_configure(struct sbi_scratch *scratch);
+void sbi_hart_pmp_fence(void);
 int sbi_hart_map_saddr(unsigned long base, unsigned long size);
 int sbi_hart_unmap_saddr(void);
+void sbi_hart_saddr_flush(void);
 int sbi_hart_priv_version(struct sbi_scratch *scratch);
 void sbi_hart_get_priv_version_str(struct sbi_scratch *scratch,
 				   char *version_str, int nvstr);
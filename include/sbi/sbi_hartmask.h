@@ -127,6 +127,17 @@ static inline void sbi_hartmask_clear_all(struct sbi_hartmask *dstp)
 	bitmap_zero(sbi_hartmask_bits(dstp), SBI_HARTMASK_MAX_BITS);
 }
 
+/**
+ * Check whether no HART is set in a hartmask
+ * @param m the hartmask pointer
+ * @return true if the hartmask is empty and false otherwise
+ */
+static inline bool sbi_hartmask_empty(const struct sbi_hartmask *m)
+{
+	return find_first_bit(m->bits, SBI_HARTMASK_MAX_BITS) >=
+		SBI_HARTMASK_MAX_BITS;
+}
+
 /**
  * *dstp = *srcp
  * @param dstp the hartmask destination
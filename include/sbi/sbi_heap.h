@@ -92,6 +92,25 @@ static inline unsigned long sbi_heap_reserved_space(void)
 	return sbi_heap_reserved_space_from(&global_hpctrl);
 }
 
+/** Highest amount (in bytes) of used space seen in the heap area */
+unsigned long sbi_heap_peak_used_space_from(struct sbi_heap_control *hpctrl);
+
+static inline unsigned long sbi_heap_peak_used_space(void)
+{
+	return sbi_heap_peak_used_space_from(&global_hpctrl);
+}
+
+/**
+ * Size (in bytes) of the largest free block in the heap area. Together
+ * with the free space this shows how fragmented the heap area is.
+ */
+unsigned long sbi_heap_largest_free_space_from(struct sbi_heap_control *hpctrl);
+
+static inline unsigned long sbi_heap_largest_free_space(void)
+{
+	return sbi_heap_largest_free_space_from(&global_hpctrl);
+}
+
 /** Initialize heap area */
 int sbi_heap_init(struct sbi_scratch *scratch);
 int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
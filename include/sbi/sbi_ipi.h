@@ -18,6 +18,8 @@
 
 /* clang-format on */
 
+struct sbi_hartmask;
+
 /** IPI hardware device */
 struct sbi_ipi_device {
 	/** Name of the IPI device */
@@ -26,6 +28,13 @@ struct sbi_ipi_device {
 	/** Send IPI to a target HART index */
 	void (*ipi_send)(u32 hart_index);
 
+	/**
+	 * Send IPI to all HART indices of a mask
+	 * Note: This is an optional callback and ipi_send() is called
+	 * for each HART index of the mask when it is not provided.
+	 */
+	void (*ipi_send_mask)(const struct sbi_hartmask *mask);
+
 	/** Clear IPI for the current hart */
 	void (*ipi_clear)(void);
 };
@@ -87,6 +96,8 @@ void sbi_ipi_process(void);
 
 int sbi_ipi_raw_send(u32 hartindex);
 
+int sbi_ipi_raw_send_mask(const struct sbi_hartmask *mask);
+
 void sbi_ipi_raw_clear(void);
 
 const struct sbi_ipi_device *sbi_ipi_get_device(void);
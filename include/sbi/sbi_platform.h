@@ -120,6 +120,9 @@ struct sbi_platform_operations {
 	/** Get tlb flush limit value **/
 	u64 (*get_tlbr_flush_limit)(void);
 
+	/** Get tlb flush limit override of one fence type (0 if none) **/
+	u64 (*get_tlbr_flush_limit_override)(u32 limit_type);
+
 	/** Get tlb fifo num entries*/
 	u32 (*get_tlb_num_entries)(void);
 
@@ -320,6 +323,26 @@ static inline u64 sbi_platform_tlbr_flush_limit(const struct sbi_platform *plat)
 	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
 }
 
+/**
+ * Get platform specific tlb range flush limit of one fence type. This
+ * takes precedence over both the boot time calibration and the value
+ * returned by sbi_platform_tlbr_flush_limit().
+ *
+ * @param plat pointer to struct sbi_platform
+ * @param limit_type fence type (enum sbi_tlb_flush_limit_type)
+ *
+ * @return tlb range flush limit value or 0 if not overridden
+ */
+static inline u64 sbi_platform_tlbr_flush_limit_override(
+					const struct sbi_platform *plat,
+					u32 limit_type)
+{
+	if (plat && sbi_platform_ops(plat)->get_tlbr_flush_limit_override)
+		return sbi_platform_ops(plat)->get_tlbr_flush_limit_override(
+								limit_type);
+	return 0;
+}
+
 /**
  * Get platform specific tlb fifo num entries.
  *
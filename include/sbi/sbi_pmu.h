@@ -145,6 +145,9 @@ int sbi_pmu_ctr_get_info(uint32_t cidx, unsigned long *ctr_info);
 int sbi_pmu_event_get_info(unsigned long shmem_lo, unsigned long shmem_high,
 						   unsigned long num_events, unsigned long flags);
 
+int sbi_pmu_snapshot_set_shmem(unsigned long shmem_lo,
+			       unsigned long shmem_hi, unsigned long flags);
+
 unsigned long sbi_pmu_num_ctr(void);
 
 int sbi_pmu_ctr_cfg_match(unsigned long cidx_base, unsigned long cidx_mask,
@@ -153,6 +156,8 @@ int sbi_pmu_ctr_cfg_match(unsigned long cidx_base, unsigned long cidx_mask,
 
 int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id);
 
+int sbi_pmu_ctr_add_fw(enum sbi_pmu_fw_event_code_id fw_id, uint64_t val);
+
 void sbi_pmu_ovf_irq();
 
 #endif
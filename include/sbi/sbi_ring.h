@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+
+#ifndef __SBI_RING_H__
+#define __SBI_RING_H__
+
+#include <sbi/sbi_types.h>
+
+/**
+ * Bounded ring with exactly one producer and one consumer
+ *
+ * The producer only writes @tail and the consumer only writes @head so
+ * neither side needs a lock. Both indices are free running and the
+ * number of entries must be a power of two.
+ */
+struct sbi_ring {
+	void *queue;
+	u32 entry_size;
+	u32 num_entries;
+	/* Written only by the consumer */
+	volatile u32 head;
+	/* Written only by the producer */
+	volatile u32 tail;
+};
+
+int sbi_ring_init(struct sbi_ring *ring, void *queue_mem, u32 entries,
+		  u32 entry_size);
+int sbi_ring_enqueue(struct sbi_ring *ring, void *data);
+int sbi_ring_dequeue(struct sbi_ring *ring, void *data);
+u32 sbi_ring_avail(struct sbi_ring *ring);
+bool sbi_ring_is_empty(struct sbi_ring *ring);
+bool sbi_ring_is_full(struct sbi_ring *ring);
+
+#endif
@@ -248,6 +248,13 @@ extern struct sbi_scratch *hartindex_to_scratch_table[];
  */
 u32 sbi_hartid_to_hartindex(u32 hartid);
 
+/**
+ * Rebuild the HART id to HART index lookup from hartindex_to_hartid_table
+ * Note: This is called by sbi_scratch_init() and only needed again if
+ * hartindex_to_hartid_table changes afterwards.
+ */
+void sbi_scratch_hartid_lookup_init(void);
+
 /** Get sbi_scratch from HART id */
 #define sbi_hartid_to_scratch(__hartid) \
 	sbi_hartindex_to_scratch(sbi_hartid_to_hartindex(__hartid))
@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+
+#ifndef __SBI_STATS_H__
+#define __SBI_STATS_H__
+
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_types.h>
+
+struct sbi_scratch;
+
+#ifdef CONFIG_SBI_STATS
+
+/** Heap space needed per HART for the latency histograms */
+#define SBI_STATS_HART_SIZE						\
+	(2 * sizeof(struct sbi_opensbi_stats_header) +			\
+	 CONFIG_SBI_STATS_ENTRIES * sizeof(struct sbi_opensbi_stats_entry))
+
+/** Current time stamp of the latency clock of this HART */
+unsigned long sbi_stats_timestamp(void);
+
+/** Account the time since start to a trap cause of this HART */
+void sbi_stats_record_trap(unsigned long mcause, unsigned long start);
+
+/** Account the time since start to an ecall function of this HART */
+void sbi_stats_record_ecall(unsigned long extid, unsigned long fid,
+			    unsigned long start);
+
+/**
+ * Copy the latency histograms of a HART into a buffer
+ *
+ * @param hartindex index of the HART
+ * @param buf buffer getting a struct sbi_opensbi_stats_header followed
+ * by as many struct sbi_opensbi_stats_entry as fit
+ * @param size size of the buffer in bytes
+ * @param reset clear the histograms after copying them
+ * @param out_entries number of histograms in use
+ *
+ * @return 0 on success and negative error code on failure
+ */
+int sbi_stats_snapshot(u32 hartindex, void *buf, unsigned long size,
+		       bool reset, unsigned long *out_entries);
+
+int sbi_stats_init(struct sbi_scratch *scratch, bool cold_boot);
+
+#else
+
+static inline unsigned long sbi_stats_timestamp(void)
+{
+	return 0;
+}
+
+static inline void sbi_stats_record_trap(unsigned long mcause,
+					 unsigned long start)
+{
+}
+
+static inline void sbi_stats_record_ecall(unsigned long extid,
+					  unsigned long fid,
+					  unsigned long start)
+{
+}
+
+static inline int sbi_stats_snapshot(u32 hartindex, void *buf,
+				     unsigned long size, bool reset,
+				     unsigned long *out_entries)
+{
+	return SBI_ENOTSUPP;
+}
+
+static inline int sbi_stats_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	return 0;
+}
+
+#endif
+
+#endif
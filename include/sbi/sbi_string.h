@@ -43,4 +43,20 @@ int sbi_memcmp(const void *s1, const void *s2, size_t count);
 
 void *sbi_memchr(const void *s, int c, size_t count);
 
+/** HART can scan strings with Zbb orc.b */
+#define SBI_STRING_HART_ZBB		(1UL << 0)
+/** HART can copy big memory blocks with vector loads/stores */
+#define SBI_STRING_HART_VECTOR		(1UL << 1)
+
+/** Per-HART acceleration state of the string functions */
+struct sbi_string_hart {
+	/* SBI_STRING_HART_xyz flags of usable accelerations */
+	unsigned long flags;
+	/* Save area of the supervisor vector registers v0-v7 */
+	void *vsave;
+};
+
+/** Scratch offset of struct sbi_string_hart (zero until HART init) */
+extern unsigned long sbi_string_hart_offset;
+
 #endif
@@ -10,6 +10,7 @@
 #ifndef __SBI_TIMER_H__
 #define __SBI_TIMER_H__
 
+#include <sbi/sbi_list.h>
 #include <sbi/sbi_types.h>
 
 /** Timer hardware device */
@@ -29,12 +30,67 @@ struct sbi_timer_device {
 	/** Stop timer event for current HART */
 	void (*timer_event_stop)(void);
 
+	/**
+	 * Start supervisor timer event for current HART (optional)
+	 *
+	 * Used instead of the M-mode timer for the S-mode timer on HARTs
+	 * with a vendor supervisor timer extension such as XTHEADSSTC.
+	 */
+	void (*timer_s_event_start)(u64 next_event);
+
 	/** Initialize timer device for current HART */
 	int (*warm_init)(void);
 };
 
+/** Firmware timer event of a HART */
+struct sbi_timer_event {
+	/** List head of the timer queue (private) */
+	struct sbi_dlist head;
+
+	/** Timer value at which the event expires */
+	u64 deadline;
+
+	/**
+	 * Called from sbi_timer_process() once the deadline has passed.
+	 * The event may be queued again from within the callback.
+	 */
+	void (*callback)(struct sbi_timer_event *ev);
+};
+
 struct sbi_scratch;
 
+/** Initialize a timer event before first use */
+static inline void sbi_timer_event_init(struct sbi_timer_event *ev,
+					void (*callback)(struct sbi_timer_event *))
+{
+	SBI_INIT_LIST_HEAD(&ev->head);
+	ev->deadline = 0;
+	ev->callback = callback;
+}
+
+/** Check whether a timer event is queued */
+static inline bool sbi_timer_event_pending(struct sbi_timer_event *ev)
+{
+	return !sbi_list_empty(&ev->head);
+}
+
+/**
+ * Queue a firmware timer event on the current HART
+ *
+ * An event which is already queued is moved to the new deadline. The
+ * hardware timer of the HART is shared with the S-mode timer and always
+ * programmed with the earliest deadline of both.
+ *
+ * @param ev timer event initialized with sbi_timer_event_init()
+ * @param deadline timer value at which the event expires
+ *
+ * @return 0 on success and negative error code on failure
+ */
+int sbi_timer_event_add(struct sbi_timer_event *ev, u64 deadline);
+
+/** Remove a firmware timer event from the queue of the current HART */
+void sbi_timer_event_cancel(struct sbi_timer_event *ev);
+
 /** Generic delay loop of desired granularity */
 void sbi_timer_delay_loop(ulong units, u64 unit_freq,
 			  void (*delay_fn)(void *), void *opaque);
@@ -18,6 +18,12 @@
 
 #define SBI_TLB_FLUSH_ALL			((unsigned long)-1)
 
+/** Maximum number of ranges sent to remote HARTs in one batch */
+#define SBI_TLB_BATCH_MAX_RANGES		32
+
+/** Minimum depth of the ring of each sender HART on a receiver HART */
+#define SBI_TLB_RING_MIN_ENTRIES		4
+
 /* clang-format on */
 
 struct sbi_scratch;
@@ -30,15 +36,44 @@ enum sbi_tlb_type {
 	SBI_TLB_HFENCE_GVMA,
 	SBI_TLB_HFENCE_VVMA_ASID,
 	SBI_TLB_HFENCE_VVMA,
+	/* Only created by sbi_tlb_request_batch() */
+	SBI_TLB_RANGE_BATCH,
 	SBI_TLB_TYPE_MAX,
 };
 
-struct sbi_tlb_info {
+/** Fence types with their own range flush limit */
+enum sbi_tlb_flush_limit_type {
+	SBI_TLB_FLUSH_LIMIT_SFENCE_VMA = 0,
+	SBI_TLB_FLUSH_LIMIT_HFENCE_GVMA,
+	SBI_TLB_FLUSH_LIMIT_HFENCE_VVMA,
+	SBI_TLB_FLUSH_LIMIT_MAX,
+};
+
+/** One range of a batched remote fence request */
+struct sbi_tlb_range {
 	unsigned long start;
 	unsigned long size;
 	uint16_t asid;
 	uint16_t vmid;
 	enum sbi_tlb_type type;
+};
+
+struct sbi_tlb_info {
+	union {
+		/* Single range request */
+		struct {
+			unsigned long start;
+			unsigned long size;
+		};
+		/* SBI_TLB_RANGE_BATCH request owned by the source HART */
+		struct {
+			const struct sbi_tlb_range *ranges;
+			unsigned long nranges;
+		};
+	};
+	uint16_t asid;
+	uint16_t vmid;
+	enum sbi_tlb_type type;
 	struct sbi_hartmask smask;
 };
 
@@ -56,6 +91,12 @@ do { \
 
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo);
 
+int sbi_tlb_request_batch(ulong hmask, ulong hbase,
+			  struct sbi_tlb_range *ranges, u32 count);
+
+void sbi_tlb_get_flush_limits_str(struct sbi_scratch *scratch,
+				  char *limits_str, int nlimits);
+
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot);
 
 #endif
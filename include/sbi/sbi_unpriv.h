@@ -36,6 +36,20 @@ DECLARE_UNPRIVILEGED_LOAD_FUNCTION(u64)
 DECLARE_UNPRIVILEGED_STORE_FUNCTION(u64)
 DECLARE_UNPRIVILEGED_LOAD_FUNCTION(ulong)
 
+/*
+ * Copy len bytes from or to lower privilege memory, as selected by the
+ * MPP (and MPV) bits of MSTATUS, using a single expected trap window.
+ * Returns the number of bytes copied. If that is less than len then trap
+ * describes the fault and trap->tval is the address of the first byte
+ * not copied. Lower privilege memory is read in whole aligned words, so
+ * sbi_copy_from_user() is not suitable for device memory with read side
+ * effects.
+ */
+ulong sbi_copy_from_user(void *dst, const void *src, ulong len,
+			 struct sbi_trap_info *trap);
+ulong sbi_copy_to_user(void *dst, const void *src, ulong len,
+		       struct sbi_trap_info *trap);
+
 ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap);
 
 #endif
@@ -22,6 +22,9 @@
 
 #define CLINT_MTIMER_OFFSET		0x4000
 
+/* T-Head supervisor timer compare registers, relative to MTIMECMP */
+#define THEAD_STIMECMP_OFFSET		0x9000
+
 #define MTIMER_REGION_ALIGN		0x1000
 
 struct aclint_mtimer_data {
@@ -38,6 +41,7 @@ struct aclint_mtimer_data {
 	/* Private details (initialized and used by ACLINT MTIMER library) */
 	struct aclint_mtimer_data *time_delta_reference;
 	unsigned long time_delta_computed;
+	unsigned long stimecmp_addr;
 	u64 (*time_rd)(volatile u64 *addr);
 	void (*time_wr)(bool timecmp, u64 value, volatile u64 *addr);
 };
@@ -7,19 +7,22 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_barrier.h>
 #include <sbi/riscv_locks.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_error.h>
 #include <sbi/sbi_fifo.h>
 #include <sbi/sbi_hart.h>
+#include <sbi/sbi_heap.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
+#include <sbi/sbi_timer.h>
 
 #define CONSOLE_TBUF_MAX 256
 
 static const struct sbi_console_device *console_dev = NULL;
 static char console_tbuf[CONSOLE_TBUF_MAX];
-static u32 console_tbuf_len;
 static spinlock_t console_out_lock	       = SPIN_LOCK_INITIALIZER;
 
 #ifdef CONFIG_CONSOLE_EARLY_BUFFER_SIZE
@@ -79,14 +82,342 @@ static void nputs_all(const char *str, unsigned long len)
 		p += nputs(&str[p], len - p);
 }
 
+#ifdef CONFIG_CONSOLE_ASYNC
+
+#define CONSOLE_RING_SIZE	CONFIG_CONSOLE_ASYNC_RING_SIZE
+/* Retry rate while the console device is busy */
+#define CONSOLE_DRAIN_HZ	1000
+
+_Static_assert((CONSOLE_RING_SIZE & (CONSOLE_RING_SIZE - 1)) == 0,
+	       "CONFIG_CONSOLE_ASYNC_RING_SIZE must be a power of two");
+
+/**
+ * Per-HART console output buffering
+ *
+ * Each HART formats into its own tbuf and appends to its own ring
+ * without taking any lock. Whichever HART holds console_out_lock drains
+ * the rings of all HARTs into the console device as far as the device
+ * accepts characters without waiting.
+ */
+struct console_hart {
+	char tbuf[CONSOLE_TBUF_MAX];
+	/* Written only by the HART holding console_out_lock */
+	volatile u32 head;
+	/* Written only by the owning HART */
+	volatile u32 tail;
+	/* Retries draining while the device is busy */
+	struct sbi_timer_event drain_event;
+	char ring[CONSOLE_RING_SIZE];
+};
+
+_Static_assert(sizeof(struct console_hart) <= SBI_CONSOLE_HART_SIZE,
+	       "SBI_CONSOLE_HART_SIZE is too small");
+
+static unsigned long console_hart_offset;
+/* Set on panic, all output is written synchronously from then on */
+static bool console_sync;
+/* HART index whose ring was being drained when the device filled up */
+static u32 console_drain_next;
+/* Set by HARTs which found console_out_lock held, makes the holder rescan */
+static volatile bool console_drain_req;
+
+/* Buffering state of this HART if its output is to be buffered now */
+static struct console_hart *console_thishart(void)
+{
+	if (!console_hart_offset || console_sync || !console_dev ||
+	    !console_dev->console_puts)
+		return NULL;
+
+	return sbi_scratch_read_type(sbi_scratch_thishart_ptr(),
+				     struct console_hart *,
+				     console_hart_offset);
+}
+
+static inline char *console_hart_tbuf(struct console_hart *ch)
+{
+	return ch->tbuf;
+}
+
+static inline struct console_hart *console_tbuf_owner(char *tbuf)
+{
+	return (struct console_hart *)(tbuf -
+				       offsetof(struct console_hart, tbuf));
+}
+
+/* Returns false if the device stopped taking characters */
+static bool console_ring_drain(struct console_hart *ch, bool wait)
+{
+	u32 head = ch->head, tail = __smp_load_acquire(&ch->tail);
+	u32 off, n;
+	unsigned long done;
+
+	while (head != tail) {
+		off = head & (CONSOLE_RING_SIZE - 1);
+		n = MIN(tail - head, CONSOLE_RING_SIZE - off);
+		done = console_dev->console_puts(&ch->ring[off], n);
+		if (!done && !wait)
+			return false;
+
+		head += done;
+		/* Hand the space back only after the device has it */
+		__smp_store_release(&ch->head, head);
+	}
+
+	return true;
+}
+
+/*
+ * Returns false if some output may still be buffered. Losing the trylock
+ * counts as success, the lock holder rescans all rings before it returns.
+ */
+static bool console_drain(bool wait)
+{
+	struct sbi_scratch *scratch;
+	struct console_hart *ch;
+	u32 i, hartindex, count;
+	bool ret;
+
+	/* Orders our ring writes before the request the holder looks at */
+	__smp_store_release(&console_drain_req, true);
+
+	if (wait)
+		spin_lock(&console_out_lock);
+	else if (!spin_trylock(&console_out_lock))
+		return true;
+
+again:
+	console_drain_req = false;
+	smp_mb();
+
+	ret = true;
+	if (!console_dev || !console_dev->console_puts)
+		goto out;
+
+	/* Resume where the device filled up to keep lines together */
+	count = sbi_scratch_last_hartindex() + 1;
+	for (i = 0; i < count; i++) {
+		hartindex = (console_drain_next + i) % count;
+		scratch = sbi_hartindex_to_scratch(hartindex);
+		if (!scratch)
+			continue;
+
+		ch = sbi_scratch_read_type(scratch, struct console_hart *,
+					   console_hart_offset);
+		if (ch && !console_ring_drain(ch, wait)) {
+			console_drain_next = hartindex;
+			ret = false;
+			break;
+		}
+	}
+	if (ret)
+		console_drain_next = 0;
+
+out:
+	spin_unlock(&console_out_lock);
+
+	/*
+	 * A HART which failed the trylock above may have appended to a
+	 * ring we had already passed. Rescan for it unless the device is
+	 * full, in which case our caller retries everything anyway.
+	 */
+	smp_mb();
+	if (ret && console_drain_req && spin_trylock(&console_out_lock))
+		goto again;
+
+	return ret;
+}
+
+/* Drain now and once more from a timer event of this HART if needed */
+static void console_kick(void)
+{
+	const struct sbi_timer_device *tdev = sbi_timer_get_device();
+	struct console_hart *ch;
+
+	if (console_drain(false))
+		return;
+
+	ch = console_thishart();
+	if (ch && tdev && tdev->timer_freq &&
+	    !sbi_timer_event_pending(&ch->drain_event))
+		sbi_timer_event_add(&ch->drain_event, sbi_timer_value() +
+				    tdev->timer_freq / CONSOLE_DRAIN_HZ);
+}
+
+static void console_drain_event(struct sbi_timer_event *ev)
+{
+	console_kick();
+}
+
+static unsigned long console_ring_put(struct console_hart *ch,
+				      const char *str, unsigned long len)
+{
+	u32 tail = ch->tail, head = __smp_load_acquire(&ch->head);
+	u32 off, n;
+	unsigned long done = 0;
+
+	len = MIN(len, CONSOLE_RING_SIZE - (tail - head));
+	while (done < len) {
+		off = tail & (CONSOLE_RING_SIZE - 1);
+		n = MIN(len - done, CONSOLE_RING_SIZE - off);
+		sbi_memcpy(&ch->ring[off], &str[done], n);
+		tail += n;
+		done += n;
+	}
+
+	/* Publish the characters before the new tail */
+	__smp_store_release(&ch->tail, tail);
+
+	return done;
+}
+
+static void console_ring_put_all(struct console_hart *ch, const char *str,
+				 unsigned long len)
+{
+	unsigned long p = 0;
+
+	while (p < len) {
+		p += console_ring_put(ch, &str[p], len - p);
+		/* Ring is full, wait for the device to make room */
+		if (p < len)
+			console_drain(true);
+	}
+}
+
+void sbi_console_drain(void)
+{
+	if (console_hart_offset && !console_sync)
+		console_kick();
+}
+
+void sbi_console_flush(void)
+{
+	if (console_hart_offset)
+		console_drain(true);
+}
+
+static void console_flush_sync(void)
+{
+	console_sync = true;
+	sbi_console_flush();
+}
+
+int sbi_console_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct console_hart *ch;
+
+	if (cold_boot) {
+		console_hart_offset =
+			sbi_scratch_alloc_type_offset(struct console_hart *);
+		if (!console_hart_offset)
+			return SBI_ENOMEM;
+	}
+
+	ch = sbi_scratch_read_type(scratch, struct console_hart *,
+				   console_hart_offset);
+	if (!ch) {
+		ch = sbi_zalloc(sizeof(*ch));
+		if (!ch)
+			return SBI_ENOMEM;
+		sbi_timer_event_init(&ch->drain_event, console_drain_event);
+		sbi_scratch_write_type(scratch, struct console_hart *,
+				       console_hart_offset, ch);
+	}
+
+	return 0;
+}
+
+#else
+
+struct console_hart;
+
+static inline struct console_hart *console_thishart(void)
+{
+	return NULL;
+}
+
+static inline char *console_hart_tbuf(struct console_hart *ch)
+{
+	return NULL;
+}
+
+static inline struct console_hart *console_tbuf_owner(char *tbuf)
+{
+	return NULL;
+}
+
+static inline bool console_drain(bool wait)
+{
+	return true;
+}
+
+static inline void console_kick(void)
+{
+}
+
+static inline void console_ring_put_all(struct console_hart *ch,
+					const char *str, unsigned long len)
+{
+}
+
+static inline unsigned long console_ring_put(struct console_hart *ch,
+					     const char *str,
+					     unsigned long len)
+{
+	return 0;
+}
+
+void sbi_console_drain(void)
+{
+}
+
+void sbi_console_flush(void)
+{
+}
+
+static inline void console_flush_sync(void)
+{
+}
+
+int sbi_console_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	return 0;
+}
+
+#endif
+
+/*
+ * Write out a whole string, into the ring of this HART if ch is set and
+ * to the device otherwise, in which case the caller holds
+ * console_out_lock.
+ */
+static void console_write(struct console_hart *ch, const char *str,
+			  unsigned long len)
+{
+	if (ch)
+		console_ring_put_all(ch, str, len);
+	else
+		nputs_all(str, len);
+}
+
 void sbi_putc(char ch)
 {
-	nputs_all(&ch, 1);
+	struct console_hart *chs = console_thishart();
+
+	console_write(chs, &ch, 1);
+	if (chs)
+		console_kick();
 }
 
 void sbi_puts(const char *str)
 {
 	unsigned long len = sbi_strlen(str);
+	struct console_hart *ch = console_thishart();
+
+	if (ch) {
+		console_write(ch, str, len);
+		console_kick();
+		return;
+	}
 
 	spin_lock(&console_out_lock);
 	nputs_all(str, len);
@@ -95,13 +426,29 @@ void sbi_puts(const char *str)
 
 unsigned long sbi_nputs(const char *str, unsigned long len)
 {
+	struct console_hart *ch = console_thishart();
 	unsigned long ret;
 
+	if (ch) {
+		/* Partial writes are fine, but make some progress */
+		ret = console_ring_put(ch, str, len);
+		if (!ret && len) {
+			console_drain(true);
+			ret = console_ring_put(ch, str, len);
+		}
+		console_kick();
+		return ret;
+	}
+
+	/*
+	 * UART console_puts only fills the transmit FIFO, don't make the
+	 * caller come back for every FIFO worth of characters.
+	 */
 	spin_lock(&console_out_lock);
-	ret = nputs(str, len);
+	nputs_all(str, len);
 	spin_unlock(&console_out_lock);
 
-	return ret;
+	return len;
 }
 
 void sbi_gets(char *s, int maxwidth, char endchar)
@@ -137,6 +484,7 @@ unsigned long sbi_ngets(char *str, unsigned long len)
 #define PAD_ALTERNATE 4
 #define PAD_SIGN 8
 #define USE_TBUF 16
+#define USE_HART_TBUF 32
 #define PRINT_BUF_LEN 64
 
 #define va_start(v, l) __builtin_va_start((v), l)
@@ -161,8 +509,10 @@ static void printc(char **out, u32 *out_len, char ch, int flags)
 		if (out_len) {
 			--(*out_len);
 			if ((flags & USE_TBUF) && *out_len == 1) {
-				nputs_all(console_tbuf, CONSOLE_TBUF_MAX - *out_len);
-				*out = console_tbuf;
+				*out -= CONSOLE_TBUF_MAX - *out_len;
+				console_write((flags & USE_HART_TBUF) ?
+					      console_tbuf_owner(*out) : NULL,
+					      *out, CONSOLE_TBUF_MAX - *out_len);
 				*out_len = CONSOLE_TBUF_MAX;
 			}
 		}
@@ -267,23 +617,27 @@ static int printi(char **out, u32 *out_len, long long i,
 	return pc + prints(out, out_len, s, width, flags);
 }
 
-static int print(char **out, u32 *out_len, const char *format, va_list args)
+static int print(char **out, u32 *out_len, struct console_hart *ch,
+		 const char *format, va_list args)
 {
 	bool flags_done;
 	int width, flags, pc = 0;
-	char type, scr[2], *tout;
+	char type, scr[2], *tout, *tbuf = NULL;
 	bool use_tbuf = (!out) ? true : false;
+	u32 tbuf_len;
 
 	/*
 	 * The console_tbuf is protected by console_out_lock and
 	 * print() is always called with console_out_lock held
-	 * when out == NULL.
+	 * when out == NULL, unless the output of this HART is
+	 * buffered in ch, which has a tbuf of its own.
 	 */
 	if (use_tbuf) {
-		console_tbuf_len = CONSOLE_TBUF_MAX;
-		tout = console_tbuf;
+		tbuf = ch ? console_hart_tbuf(ch) : console_tbuf;
+		tbuf_len = CONSOLE_TBUF_MAX;
+		tout = tbuf;
 		out = &tout;
-		out_len = &console_tbuf_len;
+		out_len = &tbuf_len;
 	}
 
 	/* handle special case: *out_len == 1*/
@@ -296,6 +650,8 @@ static int print(char **out, u32 *out_len, const char *format, va_list args)
 		width = flags = 0;
 		if (use_tbuf)
 			flags |= USE_TBUF;
+		if (ch)
+			flags |= USE_HART_TBUF;
 		if (*format == '%') {
 			++format;
 			if (*format == '\0')
@@ -400,8 +756,8 @@ literal:
 		}
 	}
 
-	if (use_tbuf && console_tbuf_len < CONSOLE_TBUF_MAX)
-		nputs_all(console_tbuf, CONSOLE_TBUF_MAX - console_tbuf_len);
+	if (use_tbuf && tbuf_len < CONSOLE_TBUF_MAX)
+		console_write(ch, tbuf, CONSOLE_TBUF_MAX - tbuf_len);
 
 	return pc;
 }
@@ -415,7 +771,7 @@ int sbi_sprintf(char *out, const char *format, ...)
 		sbi_panic("sbi_sprintf called with NULL output string\n");
 
 	va_start(args, format);
-	retval = print(&out, NULL, format, args);
+	retval = print(&out, NULL, NULL, format, args);
 	va_end(args);
 
 	return retval;
@@ -431,22 +787,38 @@ int sbi_snprintf(char *out, u32 out_sz, const char *format, ...)
 			  "output size is not zero\n");
 
 	va_start(args, format);
-	retval = print(&out, &out_sz, format, args);
+	retval = print(&out, &out_sz, NULL, format, args);
 	va_end(args);
 
 	return retval;
 }
 
+static int console_vprintf(const char *format, va_list args)
+{
+	struct console_hart *ch = console_thishart();
+	int retval;
+
+	if (ch) {
+		retval = print(NULL, NULL, ch, format, args);
+		console_kick();
+		return retval;
+	}
+
+	spin_lock(&console_out_lock);
+	retval = print(NULL, NULL, NULL, format, args);
+	spin_unlock(&console_out_lock);
+
+	return retval;
+}
+
 int sbi_printf(const char *format, ...)
 {
 	va_list args;
 	int retval;
 
-	spin_lock(&console_out_lock);
 	va_start(args, format);
-	retval = print(NULL, NULL, format, args);
+	retval = console_vprintf(format, args);
 	va_end(args);
-	spin_unlock(&console_out_lock);
 
 	return retval;
 }
@@ -458,11 +830,8 @@ int sbi_dprintf(const char *format, ...)
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
 	va_start(args, format);
-	if (scratch->options & SBI_SCRATCH_DEBUG_PRINTS) {
-		spin_lock(&console_out_lock);
-		retval = print(NULL, NULL, format, args);
-		spin_unlock(&console_out_lock);
-	}
+	if (scratch->options & SBI_SCRATCH_DEBUG_PRINTS)
+		retval = console_vprintf(format, args);
 	va_end(args);
 
 	return retval;
@@ -472,9 +841,12 @@ void sbi_panic(const char *format, ...)
 {
 	va_list args;
 
+	/* Get out what is buffered and bypass the rings from now on */
+	console_flush_sync();
+
 	spin_lock(&console_out_lock);
 	va_start(args, format);
-	print(NULL, NULL, format, args);
+	print(NULL, NULL, NULL, format, args);
 	va_end(args);
 	spin_unlock(&console_out_lock);
 
@@ -496,6 +868,8 @@ void sbi_console_set_device(const struct sbi_console_device *dev)
 
 	if (!console_dev)
 		flush_early_fifo = true;
+	else
+		sbi_console_flush();
 
 	console_dev = dev;
 
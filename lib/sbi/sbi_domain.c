@@ -122,16 +122,47 @@ void sbi_domain_memregion_init(unsigned long addr,
 	}
 }
 
-bool sbi_domain_check_addr(const struct sbi_domain *dom,
-			   unsigned long addr, unsigned long mode,
-			   unsigned long access_flags)
+static const struct sbi_domain_memregion *find_region(
+						const struct sbi_domain *dom,
+						unsigned long addr)
 {
-	bool rmmio, mmio = false;
+	unsigned long rstart, rend;
 	struct sbi_domain_memregion *reg;
-	unsigned long rstart, rend, rflags, rwx = 0, rrwx = 0;
 
-	if (!dom)
-		return false;
+	sbi_domain_for_each_memregion(dom, reg) {
+		rstart = reg->base;
+		rend = (reg->order < __riscv_xlen) ?
+			rstart + ((1UL << reg->order) - 1) : -1UL;
+		if (rstart <= addr && addr <= rend)
+			return reg;
+	}
+
+	return NULL;
+}
+
+static const struct sbi_domain_memrange *find_memrange(
+						const struct sbi_domain *dom,
+						unsigned long addr)
+{
+	u32 lo = 0, hi = dom->range_count - 1, mid;
+
+	/* The first interval always starts at address zero */
+	while (lo < hi) {
+		mid = hi - (hi - lo) / 2;
+		if (dom->ranges[mid].base <= addr)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return &dom->ranges[lo];
+}
+
+static bool is_access_allowed(unsigned long rflags, unsigned long mode,
+			      unsigned long access_flags)
+{
+	bool rmmio, mmio = false;
+	unsigned long rwx = 0, rrwx = 0;
 
 	/*
 	 * Use M_{R/W/X} bits because the SU-bits are at the
@@ -150,22 +181,38 @@ bool sbi_domain_check_addr(const struct sbi_domain *dom,
 	if (access_flags & SBI_DOMAIN_MMIO)
 		mmio = true;
 
-	sbi_domain_for_each_memregion(dom, reg) {
-		rflags = reg->flags;
-		rrwx = (mode == PRV_M ?
-			(rflags & SBI_DOMAIN_MEMREGION_M_ACCESS_MASK) :
-			(rflags & SBI_DOMAIN_MEMREGION_SU_ACCESS_MASK)
-			>> SBI_DOMAIN_MEMREGION_SU_ACCESS_SHIFT);
+	rrwx = (mode == PRV_M ?
+		(rflags & SBI_DOMAIN_MEMREGION_M_ACCESS_MASK) :
+		(rflags & SBI_DOMAIN_MEMREGION_SU_ACCESS_MASK)
+		>> SBI_DOMAIN_MEMREGION_SU_ACCESS_SHIFT);
 
-		rstart = reg->base;
-		rend = (reg->order < __riscv_xlen) ?
-			rstart + ((1UL << reg->order) - 1) : -1UL;
-		if (rstart <= addr && addr <= rend) {
-			rmmio = (rflags & SBI_DOMAIN_MEMREGION_MMIO) ? true : false;
-			if (mmio != rmmio)
-				return false;
-			return ((rrwx & rwx) == rwx) ? true : false;
-		}
+	rmmio = (rflags & SBI_DOMAIN_MEMREGION_MMIO) ? true : false;
+	if (mmio != rmmio)
+		return false;
+
+	return ((rrwx & rwx) == rwx) ? true : false;
+}
+
+bool sbi_domain_check_addr(const struct sbi_domain *dom,
+			   unsigned long addr, unsigned long mode,
+			   unsigned long access_flags)
+{
+	const struct sbi_domain_memrange *range;
+	const struct sbi_domain_memregion *reg;
+
+	if (!dom)
+		return false;
+
+	if (dom->ranges) {
+		range = find_memrange(dom, addr);
+		if (range->mapped)
+			return is_access_allowed(range->flags, mode,
+						 access_flags);
+	} else {
+		reg = find_region(dom, addr);
+		if (reg)
+			return is_access_allowed(reg->flags, mode,
+						 access_flags);
 	}
 
 	return (mode == PRV_M) ? true : false;
@@ -228,24 +275,6 @@ static bool is_region_before(const struct sbi_domain_memregion *regA,
 	return false;
 }
 
-static const struct sbi_domain_memregion *find_region(
-						const struct sbi_domain *dom,
-						unsigned long addr)
-{
-	unsigned long rstart, rend;
-	struct sbi_domain_memregion *reg;
-
-	sbi_domain_for_each_memregion(dom, reg) {
-		rstart = reg->base;
-		rend = (reg->order < __riscv_xlen) ?
-			rstart + ((1UL << reg->order) - 1) : -1UL;
-		if (rstart <= addr && addr <= rend)
-			return reg;
-	}
-
-	return NULL;
-}
-
 static const struct sbi_domain_memregion *find_next_subset_region(
 				const struct sbi_domain *dom,
 				const struct sbi_domain_memregion *reg,
@@ -403,12 +432,33 @@ bool sbi_domain_check_addr_range(const struct sbi_domain *dom,
 				 unsigned long mode,
 				 unsigned long access_flags)
 {
-	unsigned long max = addr + size;
+	unsigned long max = addr + size, last = addr + size - 1;
+	const struct sbi_domain_memrange *range, *rend;
 	const struct sbi_domain_memregion *reg, *sreg;
 
 	if (!dom)
 		return false;
 
+	if (!size)
+		return true;
+
+	if (last < addr)
+		return false;
+
+	/* Walk the intervals overlapping the range in one pass */
+	if (dom->ranges) {
+		range = find_memrange(dom, addr);
+		rend = &dom->ranges[dom->range_count];
+		do {
+			if (!range->mapped ||
+			    !is_access_allowed(range->flags, mode, access_flags))
+				return false;
+			range++;
+		} while (range < rend && range->base <= last);
+
+		return true;
+	}
+
 	while (addr < max) {
 		reg = find_region(dom, addr);
 		if (!reg)
@@ -658,6 +708,73 @@ static int root_add_memregion(const struct sbi_domain_memregion *reg)
 	return 0;
 }
 
+static u32 memrange_add_base(struct sbi_domain_memrange *ranges, u32 count,
+			     unsigned long base)
+{
+	u32 i = 0;
+
+	while (i < count && ranges[i].base < base)
+		i++;
+
+	if (i < count && ranges[i].base == base)
+		return count;
+
+	sbi_memmove(&ranges[i + 1], &ranges[i], (count - i) * sizeof(*ranges));
+	ranges[i].base = base;
+
+	return count + 1;
+}
+
+/*
+ * Split the address space at every region boundary so that each interval
+ * is decided by a single region, then merge neighbours deciding alike.
+ */
+static int domain_build_memranges(struct sbi_domain *dom)
+{
+	u32 i, count = 0, rcount = 0;
+	struct sbi_domain_memrange *ranges, *prev;
+	const struct sbi_domain_memregion *reg;
+	unsigned long flags;
+	bool mapped;
+
+	sbi_domain_for_each_memregion(dom, reg)
+		count++;
+
+	ranges = sbi_calloc(sizeof(*ranges), 2 * count + 1);
+	if (!ranges)
+		return SBI_ENOMEM;
+
+	rcount = memrange_add_base(ranges, rcount, 0);
+	sbi_domain_for_each_memregion(dom, reg) {
+		rcount = memrange_add_base(ranges, rcount, reg->base);
+		if (reg->order < __riscv_xlen)
+			rcount = memrange_add_base(ranges, rcount,
+					reg->base + (1UL << reg->order));
+	}
+
+	count = 0;
+	for (i = 0; i < rcount; i++) {
+		reg = find_region(dom, ranges[i].base);
+		mapped = reg ? true : false;
+		flags = reg ? reg->flags : 0;
+
+		prev = count ? &ranges[count - 1] : NULL;
+		if (prev && prev->mapped == mapped && prev->flags == flags)
+			continue;
+
+		ranges[count].base = ranges[i].base;
+		ranges[count].flags = flags;
+		ranges[count].mapped = mapped;
+		count++;
+	}
+
+	sbi_free(dom->ranges);
+	dom->ranges = ranges;
+	dom->range_count = count;
+
+	return 0;
+}
+
 int sbi_domain_root_add_memrange(unsigned long addr, unsigned long size,
 			   unsigned long align, unsigned long region_flags)
 {
@@ -700,6 +817,16 @@ int sbi_domain_finalize(struct sbi_scratch *scratch, u32 cold_hartid)
 		return rc;
 	}
 
+	/* Index memory regions of domains for address checks */
+	sbi_domain_for_each(dom) {
+		rc = domain_build_memranges(dom);
+		if (rc) {
+			sbi_printf("%s: failed to index regions of %s "
+				   "(error %d)\n", __func__, dom->name, rc);
+			return rc;
+		}
+	}
+
 	/* Startup boot HART of domains */
 	sbi_domain_for_each(dom) {
 		/* Domain boot HART index */
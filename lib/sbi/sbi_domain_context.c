@@ -17,6 +17,15 @@
 #include <sbi/sbi_domain_context.h>
 #include <sbi/sbi_trap.h>
 
+#if __riscv_xlen == 64
+#define PMP_CFG_PER_CSR		8
+#else
+#define PMP_CFG_PER_CSR		4
+#endif
+
+/* Only the even numbered pmpcfg CSRs exist on RV64 */
+#define PMP_CFG_CSR(__i)	(CSR_PMPCFG0 + (__i) * (__riscv_xlen / 32))
+
 /** Context representation for a hart within a domain */
 struct hart_context {
 	/** Trap-related states such as GPRs, mepc, and mstatus */
@@ -45,6 +54,39 @@ struct hart_context {
 	/** Supervisor environment configuration register */
 	unsigned long senvcfg;
 
+	/** Floating-point registers f0-f31, valid if fp_saved */
+	u64 fp[32];
+	/** Floating-point control and status register */
+	unsigned long fcsr;
+	/** Vector registers v0-v31 (32 * vlenb bytes), valid if v_saved */
+	void *vregs;
+	/** Vector start index register */
+	unsigned long vstart;
+	/** Vector length register */
+	unsigned long vl;
+	/** Vector data type register */
+	unsigned long vtype;
+	/** Vector control and status register */
+	unsigned long vcsr;
+	/** Are the floating-point registers saved in fp */
+	bool fp_saved;
+	/** Are the vector registers saved in vregs */
+	bool v_saved;
+
+	/** PMP configuration registers of the domain, valid if pmp_saved */
+	unsigned long pmpcfg[PMP_COUNT / PMP_CFG_PER_CSR];
+	/** PMP address registers of the domain, valid if pmp_saved */
+	unsigned long pmpaddr[PMP_COUNT];
+	/** Are the PMP registers of the domain captured */
+	bool pmp_saved;
+
+	/** Argument shared memory of the domain, unused if args_size is 0 */
+	unsigned long args_addr;
+	/** Size of the argument shared memory */
+	unsigned long args_size;
+	/** Firmware copy of the arguments while switching domains */
+	void *args_buf;
+
 	/** Reference to the owning domain */
 	struct sbi_domain *dom;
 	/** Previous context (caller) to jump to during context exits */
@@ -85,6 +127,282 @@ static void hart_context_set(struct sbi_domain *dom, u32 hartindex,
 	hart_context_get(sbi_domain_thishart_ptr(),			\
 			 current_hartindex())
 
+#ifdef __riscv_flen
+#if __riscv_flen == 64
+#define FP_STORE		"fsd"
+#define FP_LOAD			"fld"
+#define FP_ZERO			"fmv.d.x"
+#else
+#define FP_STORE		"fsw"
+#define FP_LOAD			"flw"
+#define FP_ZERO			"fmv.w.x"
+#endif
+#define FP_REGS			"0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,"	\
+				"16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31"
+#endif
+
+/*
+ * The trap entry path only saves the general purpose registers, so the
+ * floating-point and vector register files stay live in hardware until
+ * a domain switch has to hand them to another domain. A register file
+ * in the Initial state holds no data of the domain and is not saved;
+ * the target then gets cleared registers instead of reloaded ones.
+ *
+ * Off and Clean do not allow skipping the save: supervisor software
+ * such as Linux turns FS/VS Off while a task's registers are still
+ * live and marks them Clean after its own restore.
+ */
+static void hart_context_fp_save(struct hart_context *ctx,
+				 unsigned long mstatus)
+{
+	ctx->fp_saved = false;
+
+#ifdef __riscv_flen
+	if ((!misa_extension('D') && !misa_extension('F')) ||
+	    (mstatus & MSTATUS_FS) == MSTATUS_FS_INITIAL)
+		return;
+
+	csr_set(CSR_MSTATUS, MSTATUS_FS);
+	asm volatile(".irp n, " FP_REGS "\n\t"
+		     FP_STORE " f\\n, (\\n * 8)(%0)\n\t"
+		     ".endr\n\t"
+		     : : "r"(ctx->fp) : "memory");
+	ctx->fcsr = csr_read(CSR_FCSR);
+	ctx->fp_saved = true;
+#endif
+}
+
+static void hart_context_fp_restore(struct hart_context *ctx)
+{
+#ifdef __riscv_flen
+	if (!misa_extension('D') && !misa_extension('F'))
+		return;
+
+	csr_set(CSR_MSTATUS, MSTATUS_FS);
+	if (ctx->fp_saved) {
+		asm volatile(".irp n, " FP_REGS "\n\t"
+			     FP_LOAD " f\\n, (\\n * 8)(%0)\n\t"
+			     ".endr\n\t"
+			     : : "r"(ctx->fp) : "memory");
+		csr_write(CSR_FCSR, ctx->fcsr);
+	} else {
+		asm volatile(".irp n, " FP_REGS "\n\t"
+			     FP_ZERO " f\\n, zero\n\t"
+			     ".endr\n\t");
+		csr_write(CSR_FCSR, 0);
+	}
+#endif
+}
+
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+
+static int hart_context_v_alloc(struct hart_context *ctx)
+{
+	unsigned long mstatus;
+
+	if (!misa_extension('V'))
+		return 0;
+
+	mstatus = csr_read_set(CSR_MSTATUS, MSTATUS_VS);
+	ctx->vregs = sbi_malloc(32 * csr_read(CSR_VLENB));
+	csr_write(CSR_MSTATUS, mstatus);
+
+	return ctx->vregs ? 0 : SBI_ENOMEM;
+}
+
+static void hart_context_v_save(struct hart_context *ctx,
+				unsigned long mstatus)
+{
+	void *vregs = ctx->vregs;
+	unsigned long step;
+
+	ctx->v_saved = false;
+	if (!vregs)
+		return;
+
+	if ((mstatus & MSTATUS_VS) == MSTATUS_VS_INITIAL) {
+		ctx->vstart = ctx->vl = ctx->vtype = ctx->vcsr = 0;
+		return;
+	}
+
+	csr_set(CSR_MSTATUS, MSTATUS_VS);
+	ctx->vstart = csr_read(CSR_VSTART);
+	ctx->vl = csr_read(CSR_VL);
+	ctx->vtype = csr_read(CSR_VTYPE);
+	ctx->vcsr = csr_read(CSR_VCSR);
+	step = 8 * csr_read(CSR_VLENB);
+	csr_write(CSR_VSTART, 0);
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vs8r.v v0, (%0)\n\t"
+		     "add %0, %0, %1\n\t"
+		     "vs8r.v v8, (%0)\n\t"
+		     "add %0, %0, %1\n\t"
+		     "vs8r.v v16, (%0)\n\t"
+		     "add %0, %0, %1\n\t"
+		     "vs8r.v v24, (%0)\n\t"
+		     ".option pop\n\t"
+		     : "+r"(vregs) : "r"(step) : "memory");
+	ctx->v_saved = true;
+}
+
+static void hart_context_v_restore(struct hart_context *ctx)
+{
+	void *vregs = ctx->vregs;
+	unsigned long step, vl;
+
+	if (!vregs)
+		return;
+
+	csr_set(CSR_MSTATUS, MSTATUS_VS);
+	csr_write(CSR_VSTART, 0);
+	if (ctx->v_saved) {
+		step = 8 * csr_read(CSR_VLENB);
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vl8r.v v0, (%0)\n\t"
+			     "add %0, %0, %1\n\t"
+			     "vl8r.v v8, (%0)\n\t"
+			     "add %0, %0, %1\n\t"
+			     "vl8r.v v16, (%0)\n\t"
+			     "add %0, %0, %1\n\t"
+			     "vl8r.v v24, (%0)\n\t"
+			     ".option pop\n\t"
+			     : "+r"(vregs) : "r"(step) : "memory");
+	} else {
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvli %0, x0, e8, m8, ta, ma\n\t"
+			     "vmv.v.i v0, 0\n\t"
+			     "vmv.v.i v8, 0\n\t"
+			     "vmv.v.i v16, 0\n\t"
+			     "vmv.v.i v24, 0\n\t"
+			     ".option pop\n\t"
+			     : "=r"(vl));
+	}
+
+	/* vsetvl clears vstart so it goes last */
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvl x0, %0, %1\n\t"
+		     ".option pop\n\t"
+		     : : "r"(ctx->vl), "r"(ctx->vtype));
+	csr_write(CSR_VCSR, ctx->vcsr);
+	csr_write(CSR_VSTART, ctx->vstart);
+}
+
+#else
+
+static inline int hart_context_v_alloc(struct hart_context *ctx)
+{
+	return 0;
+}
+
+static inline void hart_context_v_save(struct hart_context *ctx,
+				       unsigned long mstatus)
+{
+	ctx->v_saved = false;
+}
+
+static inline void hart_context_v_restore(struct hart_context *ctx)
+{
+}
+
+#endif
+
+/*
+ * The PMP entries of a domain are encoded from its memory regions by
+ * sbi_hart_pmp_configure() the first time the domain runs on a HART and
+ * read back from the hardware. Later switches write the CSRs directly,
+ * touching only the entries which differ between the two domains.
+ */
+static void hart_context_pmp_save(struct hart_context *ctx,
+				  unsigned int pmp_count)
+{
+	unsigned int i;
+
+	for (i = 0; i < pmp_count; i++)
+		ctx->pmpaddr[i] = csr_read_num(CSR_PMPADDR0 + i);
+	for (i = 0; i * PMP_CFG_PER_CSR < pmp_count; i++)
+		ctx->pmpcfg[i] = csr_read_num(PMP_CFG_CSR(i));
+	ctx->pmp_saved = true;
+}
+
+static void hart_context_pmp_switch(struct hart_context *ctx,
+				    struct hart_context *dom_ctx,
+				    unsigned int pmp_count)
+{
+	unsigned int i, j, n, idx;
+	unsigned long stale;
+
+	for (i = 0; i * PMP_CFG_PER_CSR < pmp_count; i++) {
+		n = MIN(pmp_count - i * PMP_CFG_PER_CSR, PMP_CFG_PER_CSR);
+
+		stale = 0;
+		for (j = 0; j < n; j++) {
+			idx = i * PMP_CFG_PER_CSR + j;
+			if (ctx->pmpaddr[idx] != dom_ctx->pmpaddr[idx])
+				stale |= 0xffUL << (j * 8);
+		}
+
+		/* Turn entries off while their address changes */
+		if (stale) {
+			csr_write_num(PMP_CFG_CSR(i), ctx->pmpcfg[i] & ~stale);
+			for (j = 0; j < n; j++) {
+				idx = i * PMP_CFG_PER_CSR + j;
+				if (stale & (0xffUL << (j * 8)))
+					csr_write_num(CSR_PMPADDR0 + idx,
+						      dom_ctx->pmpaddr[idx]);
+			}
+		}
+
+		if (stale || ctx->pmpcfg[i] != dom_ctx->pmpcfg[i])
+			csr_write_num(PMP_CFG_CSR(i), dom_ctx->pmpcfg[i]);
+	}
+}
+
+/*
+ * Copy the argument shared memory of the current domain to the one of
+ * the target domain through a firmware buffer, as only one shared memory
+ * window can be mapped at a time.
+ */
+static int hart_context_args_copy(struct hart_context *ctx,
+				  struct hart_context *dom_ctx)
+{
+	unsigned long size = MIN(ctx->args_size, dom_ctx->args_size);
+	int rc;
+
+	if (!size)
+		return 0;
+
+	rc = sbi_hart_map_saddr(ctx->args_addr, size);
+	if (rc)
+		return rc;
+	sbi_memcpy(ctx->args_buf, (void *)ctx->args_addr, size);
+	sbi_hart_unmap_saddr();
+
+	rc = sbi_hart_map_saddr(dom_ctx->args_addr, size);
+	if (rc)
+		return rc;
+	sbi_memcpy((void *)dom_ctx->args_addr, ctx->args_buf, size);
+	sbi_hart_unmap_saddr();
+
+	return 0;
+}
+
+/*
+ * Save a CSR of the current context and write the one of the target
+ * context only if it differs. The current value is saved first so that
+ * switching a context to itself leaves the CSR alone.
+ */
+#define hart_context_csr_switch(__ctx, __dom_ctx, __csr, __field)	\
+	do {								\
+		(__ctx)->__field = csr_read(__csr);			\
+		if ((__dom_ctx)->__field != (__ctx)->__field)		\
+			csr_write(__csr, (__dom_ctx)->__field);		\
+	} while (0)
+
 /**
  * Switches the HART context from the current domain to the target domain.
  * This includes changing domain assignments and reconfiguring PMP, as well
@@ -92,9 +410,11 @@ static void hart_context_set(struct sbi_domain *dom, u32 hartindex,
  *
  * @param ctx pointer to the current HART context
  * @param dom_ctx pointer to the target domain context
+ *
+ * @return 0 on success and negative error code on failure
  */
-static void switch_to_next_domain_context(struct hart_context *ctx,
-					  struct hart_context *dom_ctx)
+static int switch_to_next_domain_context(struct hart_context *ctx,
+					 struct hart_context *dom_ctx)
 {
 	u32 hartindex = current_hartindex();
 	struct sbi_trap_context *trap_ctx;
@@ -102,6 +422,13 @@ static void switch_to_next_domain_context(struct hart_context *ctx,
 	struct sbi_domain *target_dom = dom_ctx->dom;
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 	unsigned int pmp_count = sbi_hart_pmp_count(scratch);
+	int priv_version = sbi_hart_priv_version(scratch);
+	int rc;
+
+	/* Pass the arguments while the current domain's PMP is active */
+	rc = hart_context_args_copy(ctx, dom_ctx);
+	if (rc)
+		return rc;
 
 	/* Assign current hart to target domain */
 	spin_lock(&current_dom->assigned_harts_lock);
@@ -115,28 +442,42 @@ static void switch_to_next_domain_context(struct hart_context *ctx,
 	spin_unlock(&target_dom->assigned_harts_lock);
 
 	/* Reconfigure PMP settings for the new domain */
-	for (int i = 0; i < pmp_count; i++) {
-		pmp_disable(i);
+	sbi_hart_saddr_flush();
+	if (!ctx->pmp_saved)
+		hart_context_pmp_save(ctx, pmp_count);
+	if (dom_ctx->pmp_saved) {
+		hart_context_pmp_switch(ctx, dom_ctx, pmp_count);
+		sbi_hart_pmp_fence();
+	} else {
+		for (int i = 0; i < pmp_count; i++) {
+			pmp_disable(i);
+		}
+		sbi_hart_pmp_configure(scratch);
+		hart_context_pmp_save(dom_ctx, pmp_count);
 	}
-	sbi_hart_pmp_configure(scratch);
 
 	/* Save current CSR context and restore target domain's CSR context */
-	ctx->sstatus	= csr_swap(CSR_SSTATUS, dom_ctx->sstatus);
-	ctx->sie	= csr_swap(CSR_SIE, dom_ctx->sie);
-	ctx->stvec	= csr_swap(CSR_STVEC, dom_ctx->stvec);
-	ctx->sscratch	= csr_swap(CSR_SSCRATCH, dom_ctx->sscratch);
-	ctx->sepc	= csr_swap(CSR_SEPC, dom_ctx->sepc);
-	ctx->scause	= csr_swap(CSR_SCAUSE, dom_ctx->scause);
-	ctx->stval	= csr_swap(CSR_STVAL, dom_ctx->stval);
-	ctx->sip	= csr_swap(CSR_SIP, dom_ctx->sip);
-	ctx->satp	= csr_swap(CSR_SATP, dom_ctx->satp);
-	if (sbi_hart_priv_version(scratch) >= SBI_HART_PRIV_VER_1_10)
-		ctx->scounteren = csr_swap(CSR_SCOUNTEREN, dom_ctx->scounteren);
-	if (sbi_hart_priv_version(scratch) >= SBI_HART_PRIV_VER_1_12)
-		ctx->senvcfg	= csr_swap(CSR_SENVCFG, dom_ctx->senvcfg);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SSTATUS, sstatus);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SIE, sie);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_STVEC, stvec);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SSCRATCH, sscratch);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SEPC, sepc);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SCAUSE, scause);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_STVAL, stval);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SIP, sip);
+	hart_context_csr_switch(ctx, dom_ctx, CSR_SATP, satp);
+	if (priv_version >= SBI_HART_PRIV_VER_1_10)
+		hart_context_csr_switch(ctx, dom_ctx, CSR_SCOUNTEREN,
+					scounteren);
+	if (priv_version >= SBI_HART_PRIV_VER_1_12)
+		hart_context_csr_switch(ctx, dom_ctx, CSR_SENVCFG, senvcfg);
 
 	/* Save current trap state and restore target domain's trap state */
 	trap_ctx = sbi_trap_get_context(scratch);
+	hart_context_fp_save(ctx, trap_ctx->regs.mstatus);
+	hart_context_v_save(ctx, trap_ctx->regs.mstatus);
+	hart_context_fp_restore(dom_ctx);
+	hart_context_v_restore(dom_ctx);
 	sbi_memcpy(&ctx->trap_ctx, trap_ctx, sizeof(*trap_ctx));
 	sbi_memcpy(trap_ctx, &dom_ctx->trap_ctx, sizeof(*trap_ctx));
 
@@ -155,23 +496,90 @@ static void switch_to_next_domain_context(struct hart_context *ctx,
 		else
 			sbi_hsm_hart_stop(scratch, true);
 	}
+
+	return 0;
+}
+
+/* Free the contexts of the current HART in all domains */
+static void hart_context_thishart_free(void)
+{
+	u32 hartindex = current_hartindex();
+	struct hart_context *dom_ctx;
+	struct sbi_domain *dom;
+
+	sbi_domain_for_each(dom) {
+		dom_ctx = hart_context_get(dom, hartindex);
+		if (!dom_ctx)
+			continue;
+
+		hart_context_set(dom, hartindex, NULL);
+		sbi_free(dom_ctx->vregs);
+		sbi_free(dom_ctx->args_buf);
+		sbi_free(dom_ctx);
+	}
+}
+
+/*
+ * Allocate the contexts of the current HART in all domains it can run
+ * in, the first time it enters or exits a domain context.
+ */
+static struct hart_context *hart_context_thishart_alloc(void)
+{
+	u32 hartindex = current_hartindex();
+	struct hart_context *dom_ctx;
+	struct sbi_domain *dom;
+
+	sbi_domain_for_each(dom) {
+		if (!sbi_hartmask_test_hartindex(hartindex,
+						 dom->possible_harts))
+			continue;
+
+		dom_ctx = sbi_zalloc(sizeof(struct hart_context));
+		if (!dom_ctx)
+			goto fail;
+
+		/* Bind context and domain */
+		dom_ctx->dom = dom;
+		hart_context_set(dom, hartindex, dom_ctx);
+
+		if (hart_context_v_alloc(dom_ctx))
+			goto fail;
+	}
+
+	return hart_context_thishart_get();
+
+fail:
+	hart_context_thishart_free();
+	return NULL;
 }
 
 int sbi_domain_context_enter(struct sbi_domain *dom)
 {
 	struct hart_context *ctx = hart_context_thishart_get();
-	struct hart_context *dom_ctx = hart_context_get(dom, current_hartindex());
+	struct hart_context *dom_ctx, *prev_ctx;
+	int rc;
+
+	if (!ctx) {
+		ctx = hart_context_thishart_alloc();
+		if (!ctx)
+			return SBI_ENOMEM;
+	}
+
+	dom_ctx = hart_context_get(dom, current_hartindex());
 
 	/* Validate the domain context existence */
 	if (!dom_ctx)
 		return SBI_EINVAL;
 
 	/* Update target context's previous context to indicate the caller */
+	prev_ctx = dom_ctx->prev_ctx;
 	dom_ctx->prev_ctx = ctx;
 
-	switch_to_next_domain_context(ctx, dom_ctx);
+	rc = switch_to_next_domain_context(ctx, dom_ctx);
+	if (rc)
+		dom_ctx->prev_ctx = prev_ctx;
 
-	return 0;
+	return rc;
 }
 
 int sbi_domain_context_exit(void)
@@ -187,21 +595,9 @@ int sbi_domain_context_exit(void)
 	 * its context on the current hart if valid.
 	 */
 	if (!ctx) {
-		sbi_domain_for_each(dom) {
-			if (!sbi_hartmask_test_hartindex(hartindex,
-							 dom->possible_harts))
-				continue;
-
-			dom_ctx = sbi_zalloc(sizeof(struct hart_context));
-			if (!dom_ctx)
-				return SBI_ENOMEM;
-
-			/* Bind context and domain */
-			dom_ctx->dom = dom;
-			hart_context_set(dom, hartindex, dom_ctx);
-		}
-
-		ctx = hart_context_thishart_get();
+		ctx = hart_context_thishart_alloc();
+		if (!ctx)
+			return SBI_ENOMEM;
 	}
 
 	dom_ctx = ctx->prev_ctx;
@@ -225,7 +621,33 @@ int sbi_domain_context_exit(void)
 	if (!dom_ctx)
 		dom_ctx = hart_context_get(&root, hartindex);
 
-	switch_to_next_domain_context(ctx, dom_ctx);
+	return switch_to_next_domain_context(ctx, dom_ctx);
+}
+
+int sbi_domain_context_set_args(unsigned long addr, unsigned long size)
+{
+	struct hart_context *ctx = hart_context_thishart_get();
+	void *buf = NULL;
+
+	if (size > SBI_DOMAIN_CONTEXT_ARGS_MAX)
+		return SBI_EINVAL;
+
+	if (!ctx) {
+		ctx = hart_context_thishart_alloc();
+		if (!ctx)
+			return SBI_ENOMEM;
+	}
+
+	if (size) {
+		buf = sbi_malloc(size);
+		if (!buf)
+			return SBI_ENOMEM;
+	}
+
+	sbi_free(ctx->args_buf);
+	ctx->args_buf = buf;
+	ctx->args_addr = addr;
+	ctx->args_size = size;
 
 	return 0;
 }
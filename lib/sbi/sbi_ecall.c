@@ -7,10 +7,14 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_stats.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_trap.h>
 
@@ -40,18 +44,135 @@ void sbi_ecall_set_impid(unsigned long impid)
 
 static SBI_LIST_HEAD(ecall_exts_list);
 
-struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+/*
+ * The ecall path looks up extensions in a direct-mapped hash table of
+ * extension IDs first and falls back to a binary search over the
+ * registered ranges sorted by extid_start. Both are rebuilt from
+ * ecall_exts_list whenever an extension is registered or unregistered,
+ * which only happens during boot.
+ */
+#define ECALL_EXT_MAX			64
+#define ECALL_HASH_BITS			6
+#define ECALL_HASH_SIZE			(1UL << ECALL_HASH_BITS)
+#define ECALL_HASH_MAX_RANGE		16
+#define ECALL_HASH_SEEDS		256
+#define ECALL_HASH_MULT			0x9e3779b1U
+
+struct ecall_hash_slot {
+	unsigned long extid;
+	struct sbi_ecall_extension *ext;
+};
+
+static struct sbi_ecall_extension *ecall_exts_sorted[ECALL_EXT_MAX];
+static u32 ecall_exts_count;
+static struct ecall_hash_slot ecall_hash[ECALL_HASH_SIZE];
+static u32 ecall_hash_mult = ECALL_HASH_MULT;
+
+static inline u32 ecall_hash_index(unsigned long extid, u32 mult)
+{
+	return ((u32)extid * mult) >> (32 - ECALL_HASH_BITS);
+}
+
+static bool ecall_hash_ext(const struct sbi_ecall_extension *ext)
+{
+	return ext->extid_end - ext->extid_start < ECALL_HASH_MAX_RANGE;
+}
+
+/* Number of hashed extension IDs which collide with an earlier one */
+static u32 ecall_hash_collisions(u32 mult)
+{
+	unsigned long used[BITS_TO_LONGS(ECALL_HASH_SIZE)] = { 0 };
+	struct sbi_ecall_extension *t;
+	unsigned long extid;
+	u32 i, idx, ret = 0;
+
+	for (i = 0; i < ecall_exts_count; i++) {
+		t = ecall_exts_sorted[i];
+		if (!ecall_hash_ext(t))
+			continue;
+		extid = t->extid_start;
+		do {
+			idx = ecall_hash_index(extid, mult);
+			if (__test_bit(idx, used))
+				ret++;
+			__set_bit(idx, used);
+		} while (extid++ != t->extid_end);
+	}
+
+	return ret;
+}
+
+static void ecall_exts_rebuild(void)
 {
-	struct sbi_ecall_extension *t, *ret = NULL;
+	struct sbi_ecall_extension *t;
+	unsigned long extid;
+	u32 i, j, mult, coll, best = -1U;
+	struct ecall_hash_slot *slot;
 
+	/* Insertion sort by extid_start, ranges never overlap */
+	ecall_exts_count = 0;
 	sbi_list_for_each_entry(t, &ecall_exts_list, head) {
-		if (t->extid_start <= extid && extid <= t->extid_end) {
-			ret = t;
-			break;
+		for (j = ecall_exts_count; j > 0; j--) {
+			if (ecall_exts_sorted[j - 1]->extid_start < t->extid_start)
+				break;
+			ecall_exts_sorted[j] = ecall_exts_sorted[j - 1];
 		}
+		ecall_exts_sorted[j] = t;
+		ecall_exts_count++;
 	}
 
-	return ret;
+	/*
+	 * Look for a multiplier which hashes all extension IDs without
+	 * collisions. Colliding IDs simply take the binary search path.
+	 */
+	for (i = 0; i < ECALL_HASH_SEEDS && best; i++) {
+		mult = ECALL_HASH_MULT + 2 * i;
+		coll = ecall_hash_collisions(mult);
+		if (coll < best) {
+			best = coll;
+			ecall_hash_mult = mult;
+		}
+	}
+
+	sbi_memset(ecall_hash, 0, sizeof(ecall_hash));
+	for (i = 0; i < ecall_exts_count; i++) {
+		t = ecall_exts_sorted[i];
+		if (!ecall_hash_ext(t))
+			continue;
+		extid = t->extid_start;
+		do {
+			slot = &ecall_hash[ecall_hash_index(extid,
+							    ecall_hash_mult)];
+			if (!slot->ext) {
+				slot->extid = extid;
+				slot->ext = t;
+			}
+		} while (extid++ != t->extid_end);
+	}
+}
+
+struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+{
+	const struct ecall_hash_slot *slot;
+	struct sbi_ecall_extension *t;
+	u32 lo = 0, hi = ecall_exts_count, mid;
+
+	slot = &ecall_hash[ecall_hash_index(extid, ecall_hash_mult)];
+	if (slot->ext && slot->extid == extid)
+		return slot->ext;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		t = ecall_exts_sorted[mid];
+		if (extid < t->extid_start)
+			hi = mid;
+		else if (t->extid_end < extid)
+			lo = mid + 1;
+		else
+			return t;
+	}
+
+	return NULL;
 }
 
 void sbi_ecall_get_extensions_str(char *exts_str, int exts_str_size, bool experimental)
@@ -93,8 +214,12 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 			return SBI_EINVAL;
 	}
 
+	if (ecall_exts_count >= ECALL_EXT_MAX)
+		return SBI_ENOSPC;
+
 	SBI_INIT_LIST_HEAD(&ext->head);
 	sbi_list_add_tail(&ext->head, &ecall_exts_list);
+	ecall_exts_rebuild();
 
 	return 0;
 }
@@ -114,23 +239,26 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext)
 		}
 	}
 
-	if (found)
+	if (found) {
 		sbi_list_del_init(&ext->head);
+		ecall_exts_rebuild();
+	}
 }
 
-int sbi_ecall_handler(struct sbi_trap_context *tcntx)
+static void ecall_handle(struct sbi_trap_regs *regs)
 {
 	int ret = 0;
-	struct sbi_trap_regs *regs = &tcntx->regs;
 	struct sbi_ecall_extension *ext;
 	unsigned long extension_id = regs->a7;
 	unsigned long func_id = regs->a6;
 	struct sbi_ecall_return out = {0};
 	bool is_0_1_spec = 0;
+	unsigned long stats_start = sbi_stats_timestamp();
 
 	ext = sbi_ecall_find_extension(extension_id);
 	if (ext && ext->handle) {
 		ret = ext->handle(extension_id, func_id, regs, &out);
+		sbi_stats_record_ecall(extension_id, func_id, stats_start);
 		if (extension_id >= SBI_EXT_0_1_SET_TIMER &&
 		    extension_id <= SBI_EXT_0_1_SHUTDOWN)
 			is_0_1_spec = 1;
@@ -161,10 +289,54 @@ int sbi_ecall_handler(struct sbi_trap_context *tcntx)
 		if (!is_0_1_spec)
 			regs->a1 = out.value;
 	}
+}
+
+int sbi_ecall_handler(struct sbi_trap_context *tcntx)
+{
+	ecall_handle(&tcntx->regs);
 
 	return 0;
 }
 
+#ifdef CONFIG_SBI_ECALL_FAST_PATH
+struct sbi_trap_regs *sbi_ecall_fast_handler(struct sbi_trap_regs *regs)
+{
+	unsigned long stats_start;
+
+	/*
+	 * Only calls which never look at the trap context, redirect traps,
+	 * switch the HART state or raise SSE events for this HART.
+	 */
+	switch (regs->a7) {
+	case SBI_EXT_TIME:
+	case SBI_EXT_IPI:
+	case SBI_EXT_RFENCE:
+		break;
+	case SBI_EXT_PMU:
+		if (regs->a6 == SBI_EXT_PMU_COUNTER_FW_READ ||
+		    regs->a6 == SBI_EXT_PMU_COUNTER_FW_READ_HI)
+			break;
+		return NULL;
+	default:
+		return NULL;
+	}
+
+	/* Nested traps are fine from here on, see TRAP_SAVE_INFO */
+#if __riscv_xlen == 32
+	csr_clear(CSR_MSTATUSH, MSTATUSH_MDT);
+#else
+	csr_clear(CSR_MSTATUS, MSTATUS_MDT);
+#endif
+
+	stats_start = sbi_stats_timestamp();
+	ecall_handle(regs);
+	sbi_hart_saddr_flush();
+	sbi_stats_record_trap(CAUSE_SUPERVISOR_ECALL, stats_start);
+
+	return regs;
+}
+#endif
+
 int sbi_ecall_init(void)
 {
 	int ret;
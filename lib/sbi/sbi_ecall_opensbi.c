@@ -0,0 +1,257 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_domain_context.h>
+#include <sbi/sbi_ecall.h>
+#include <sbi/sbi_ecall_interface.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_stats.h>
+#include <sbi/sbi_tlb.h>
+#include <sbi/sbi_trap.h>
+
+static int opensbi_rfence_entry_to_range(const struct sbi_rfence_batch_entry *e,
+					 struct sbi_tlb_range *range)
+{
+	unsigned long vmid = 0;
+
+	if (e->fid >= SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA_VMID &&
+	    e->fid <= SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA) {
+		if (!misa_extension('H'))
+			return SBI_ENOTSUPP;
+		vmid = (csr_read(CSR_HGATP) & HGATP_VMID_MASK);
+		vmid = vmid >> HGATP_VMID_SHIFT;
+	}
+
+	range->start = e->start_addr;
+	range->size = e->size;
+	range->asid = 0;
+	range->vmid = 0;
+
+	switch (e->fid) {
+	case SBI_EXT_RFENCE_REMOTE_FENCE_I:
+		range->start = range->size = 0;
+		range->type = SBI_TLB_FENCE_I;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA:
+		range->type = SBI_TLB_SFENCE_VMA;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_SFENCE_VMA_ASID:
+		range->asid = e->asid_vmid;
+		range->type = SBI_TLB_SFENCE_VMA_ASID;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA:
+		range->type = SBI_TLB_HFENCE_GVMA;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_GVMA_VMID:
+		range->vmid = e->asid_vmid;
+		range->type = SBI_TLB_HFENCE_GVMA_VMID;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA:
+		range->vmid = vmid;
+		range->type = SBI_TLB_HFENCE_VVMA;
+		break;
+	case SBI_EXT_RFENCE_REMOTE_HFENCE_VVMA_ASID:
+		range->asid = e->asid_vmid;
+		range->vmid = vmid;
+		range->type = SBI_TLB_HFENCE_VVMA_ASID;
+		break;
+	default:
+		return SBI_EINVAL;
+	}
+
+	return 0;
+}
+
+static int opensbi_rfence_batch(unsigned long hmask, unsigned long hbase,
+				unsigned long shmem_phys_lo,
+				unsigned long shmem_phys_hi,
+				unsigned long num_entries)
+{
+	int ret;
+	u32 i, count;
+	unsigned long smode, shmem_size;
+	struct sbi_rfence_batch_entry *entries;
+	struct sbi_tlb_range ranges[SBI_TLB_BATCH_MAX_RANGES];
+
+	/*
+	 * On RV32, the M-mode can only access the first 4GB of
+	 * the physical address space because M-mode does not have
+	 * MMU to access full 34-bit physical address space.
+	 *
+	 * Based on above, we simply fail if the upper 32bits of
+	 * the physical address (i.e. a3 register) is non-zero on
+	 * RV32.
+	 */
+	if (shmem_phys_hi)
+		return SBI_EINVALID_ADDR;
+
+	if (!num_entries || (shmem_phys_lo & (sizeof(unsigned long) - 1)))
+		return SBI_EINVAL;
+
+	shmem_size = num_entries * sizeof(*entries);
+	if (shmem_size / sizeof(*entries) != num_entries)
+		return SBI_EINVAL;
+
+	smode = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(),
+					 shmem_phys_lo, shmem_size, smode,
+					 SBI_DOMAIN_READ))
+		return SBI_EINVALID_ADDR;
+
+	entries = (struct sbi_rfence_batch_entry *)shmem_phys_lo;
+	while (num_entries) {
+		count = MIN(num_entries, SBI_TLB_BATCH_MAX_RANGES);
+
+		ret = 0;
+		sbi_hart_map_saddr((unsigned long)entries,
+				   count * sizeof(*entries));
+		for (i = 0; i < count && !ret; i++)
+			ret = opensbi_rfence_entry_to_range(&entries[i],
+							    &ranges[i]);
+		sbi_hart_unmap_saddr();
+		if (ret)
+			return ret;
+
+		ret = sbi_tlb_request_batch(hmask, hbase, ranges, count);
+		if (ret)
+			return ret;
+
+		entries += count;
+		num_entries -= count;
+	}
+
+	return 0;
+}
+
+static int opensbi_stats_snapshot(unsigned long hartid,
+				  unsigned long shmem_phys_lo,
+				  unsigned long shmem_phys_hi,
+				  unsigned long shmem_size,
+				  unsigned long flags,
+				  unsigned long *out_entries)
+{
+	int ret;
+	unsigned long smode;
+	u32 hartindex = sbi_hartid_to_hartindex(hartid);
+	struct sbi_domain *dom = sbi_domain_thishart_ptr();
+
+	/* Same restriction as for the batched RFENCE shared memory */
+	if (shmem_phys_hi)
+		return SBI_EINVALID_ADDR;
+
+	if (flags & ~SBI_OPENSBI_STATS_RESET)
+		return SBI_EINVAL;
+
+	if (!sbi_hartindex_valid(hartindex) ||
+	    !sbi_domain_is_assigned_hart(dom, hartindex))
+		return SBI_EINVAL;
+
+	if (shmem_phys_lo & (sizeof(u64) - 1))
+		return SBI_EINVAL;
+
+	smode = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+	if (!sbi_domain_check_addr_range(dom, shmem_phys_lo, shmem_size, smode,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	sbi_hart_map_saddr(shmem_phys_lo, shmem_size);
+	ret = sbi_stats_snapshot(hartindex, (void *)shmem_phys_lo, shmem_size,
+				 flags & SBI_OPENSBI_STATS_RESET, out_entries);
+	sbi_hart_unmap_saddr();
+
+	return ret;
+}
+
+#ifdef CONFIG_SBI_ECALL_OPENSBI_DOMAIN
+static int opensbi_domain_enter(unsigned long index)
+{
+	struct sbi_domain *dom;
+
+	sbi_domain_for_each(dom) {
+		if (dom->index == index)
+			return sbi_domain_context_enter(dom);
+	}
+
+	return SBI_EINVAL;
+}
+
+static int opensbi_domain_set_args(unsigned long shmem_phys_lo,
+				   unsigned long shmem_phys_hi,
+				   unsigned long shmem_size)
+{
+	unsigned long smode;
+
+	/* Same restriction as for the batched RFENCE shared memory */
+	if (shmem_phys_hi)
+		return SBI_EINVALID_ADDR;
+
+	if (!shmem_size)
+		return sbi_domain_context_set_args(0, 0);
+
+	if (shmem_phys_lo & (sizeof(unsigned long) - 1))
+		return SBI_EINVAL;
+
+	smode = (csr_read(CSR_MSTATUS) & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(),
+					 shmem_phys_lo, shmem_size, smode,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	return sbi_domain_context_set_args(shmem_phys_lo, shmem_size);
+}
+#endif
+
+static int sbi_ecall_opensbi_handler(unsigned long extid, unsigned long funcid,
+				     struct sbi_trap_regs *regs,
+				     struct sbi_ecall_return *out)
+{
+	int ret;
+
+	switch (funcid) {
+	case SBI_EXT_OPENSBI_RFENCE_BATCH:
+		ret = opensbi_rfence_batch(regs->a0, regs->a1, regs->a2,
+					   regs->a3, regs->a4);
+		break;
+	case SBI_EXT_OPENSBI_STATS_SNAPSHOT:
+		ret = opensbi_stats_snapshot(regs->a0, regs->a1, regs->a2,
+					     regs->a3, regs->a4, &out->value);
+		break;
+#ifdef CONFIG_SBI_ECALL_OPENSBI_DOMAIN
+	case SBI_EXT_OPENSBI_DOMAIN_ENTER:
+		ret = opensbi_domain_enter(regs->a0);
+		break;
+	case SBI_EXT_OPENSBI_DOMAIN_EXIT:
+		ret = sbi_domain_context_exit();
+		break;
+	case SBI_EXT_OPENSBI_DOMAIN_SET_ARGS:
+		ret = opensbi_domain_set_args(regs->a0, regs->a1, regs->a2);
+		break;
+#endif
+	default:
+		ret = SBI_ENOTSUPP;
+	}
+
+	return ret;
+}
+
+struct sbi_ecall_extension ecall_opensbi;
+
+static int sbi_ecall_opensbi_register_extensions(void)
+{
+	return sbi_ecall_register_extension(&ecall_opensbi);
+}
+
+struct sbi_ecall_extension ecall_opensbi = {
+	.name			= "opensbi",
+	.extid_start		= SBI_EXT_OPENSBI,
+	.extid_end		= SBI_EXT_OPENSBI,
+	.experimental		= true,
+	.register_extensions	= sbi_ecall_opensbi_register_extensions,
+	.handle			= sbi_ecall_opensbi_handler,
+};
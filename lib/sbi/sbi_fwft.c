@@ -13,8 +13,12 @@
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_heap.h>
+#include <sbi/sbi_fwft.h>
 #include <sbi/sbi_scratch.h>
+#include <sbi/sbi_sse.h>
 #include <sbi/sbi_string.h>
+#include <sbi/sbi_timer.h>
+#include <sbi/sbi_trap.h>
 #include <sbi/sbi_types.h>
 
 #include <sbi/riscv_asm.h>
@@ -48,7 +52,26 @@ struct fwft_config {
 	unsigned long flags;
 };
 
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+/* Misaligned traps are counted in windows of this many milliseconds */
+#define MIS_RATE_WINDOW_MS	10
+#define MIS_RATE_WINDOW_TRAPS						\
+	MAX(CONFIG_SBI_FWFT_MISALIGNED_RATE * MIS_RATE_WINDOW_MS / 1000, 1)
+
+struct fwft_misaligned_rate {
+	/** Start of the current window in timer ticks */
+	u64 window_start;
+	/** Misaligned traps taken in the current window */
+	unsigned long traps;
+	/** Rate exceeded, wait for S-mode to react before counting again */
+	bool tripped;
+};
+#endif
+
 struct fwft_hart_state {
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+	struct fwft_misaligned_rate mis_rate;
+#endif
 	unsigned int config_count;
 	struct fwft_config configs[];
 };
@@ -116,15 +139,42 @@ static int fwft_misaligned_delegation_supported(struct fwft_config *conf)
 	return SBI_OK;
 }
 
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+static void fwft_misaligned_rate_reset(void)
+{
+	struct fwft_hart_state *fhs = fwft_thishart_state_ptr();
+
+	fhs->mis_rate.window_start = sbi_timer_value();
+	fhs->mis_rate.traps = 0;
+	fhs->mis_rate.tripped = false;
+}
+
+static void fwft_misaligned_sse_complete(uint32_t event_id)
+{
+	fwft_misaligned_rate_reset();
+}
+
+static const struct sbi_sse_cb_ops fwft_misaligned_sse_cb_ops = {
+	.complete_cb = fwft_misaligned_sse_complete,
+};
+#else
+static inline void fwft_misaligned_rate_reset(void)
+{
+}
+#endif
+
 static int fwft_set_misaligned_delegation(struct fwft_config *conf,
 					 unsigned long value)
 {
+	if (value != 0 && value != 1)
+		return SBI_EINVAL;
+
+	fwft_misaligned_rate_reset();
+
 	if (value == 1)
 		csr_set(CSR_MEDELEG, MIS_DELEG);
-	else if (value == 0)
-		csr_clear(CSR_MEDELEG, MIS_DELEG);
 	else
-		return SBI_EINVAL;
+		csr_clear(CSR_MEDELEG, MIS_DELEG);
 
 	return SBI_OK;
 }
@@ -360,6 +410,63 @@ int sbi_fwft_get(enum sbi_fwft_feature_t feature, unsigned long *out_val)
 	return conf->feature->get(conf, out_val);
 }
 
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+/*
+ * Called for every misaligned load/store trap taken to M-mode. Once more
+ * than CONFIG_SBI_FWFT_MISALIGNED_RATE traps per second are emulated for
+ * S/U-mode, tell S-mode through an SSE event so it can take over with
+ * FWFT, or delegate right away if nobody listens and the policy allows it.
+ * Traps from M-mode and traps taken before sbi_fwft_init() are ignored.
+ */
+void sbi_fwft_misaligned_trap(const struct sbi_trap_regs *regs)
+{
+	struct fwft_hart_state *fhs;
+	struct fwft_misaligned_rate *rate;
+	const struct sbi_timer_device *tdev;
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO_DELEG
+	struct fwft_config *conf;
+#endif
+	u64 now;
+
+	if (!fwft_ptr_offset ||
+	    sbi_mstatus_prev_mode(regs->mstatus) == PRV_M)
+		return;
+
+	fhs = fwft_thishart_state_ptr();
+	if (!fhs)
+		return;
+
+	rate = &fhs->mis_rate;
+	if (rate->tripped || ++rate->traps < MIS_RATE_WINDOW_TRAPS)
+		return;
+
+	tdev = sbi_timer_get_device();
+	now = sbi_timer_value();
+	if (!tdev || now - rate->window_start >=
+		     (u64)tdev->timer_freq * MIS_RATE_WINDOW_MS / 1000) {
+		rate->window_start = now;
+		rate->traps = 0;
+		return;
+	}
+
+	rate->tripped = true;
+	if (!sbi_sse_inject_event(SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE))
+		return;
+
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO_DELEG
+	/* A locked setting is the choice of S-mode, leave it alone */
+	conf = get_feature_config(SBI_FWFT_MISALIGNED_EXC_DELEG);
+	if (conf && !(conf->flags & SBI_FWFT_SET_FLAG_LOCK) &&
+	    !fwft_misaligned_delegation_supported(conf)) {
+		csr_set(CSR_MEDELEG, MIS_DELEG);
+		sbi_dprintf("%s: hart%u: misaligned trap rate exceeded, "
+			    "delegating misaligned exceptions\n",
+			    __func__, current_hartid());
+	}
+#endif
+}
+#endif
+
 static const struct fwft_feature features[] =
 {
 	{
@@ -426,6 +533,11 @@ int sbi_fwft_init(struct sbi_scratch *scratch, bool cold_boot)
 		fwft_set_hart_state_ptr(scratch, fhs);
 	}
 
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+	sbi_sse_set_cb_ops(SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE,
+			   &fwft_misaligned_sse_cb_ops);
+#endif
+
 	for (i = 0; i < array_size(features); i++)
 		fwft_clear_config_lock(features[i].id);
 
@@ -17,6 +17,7 @@
 #include <sbi/sbi_csr_detect.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_hart.h>
+#include <sbi/sbi_heap.h>
 #include <sbi/sbi_math.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
@@ -31,6 +32,26 @@ void (*sbi_hart_expected_trap)(void) = &__sbi_expected_trap;
 
 static unsigned long hart_features_offset;
 
+/** Shared memory mapping entries of a HART */
+struct hart_saddr {
+	/** NAPOT base of the mapping in each entry */
+	unsigned long base[SBI_SMEPMP_SADDR_SLOTS];
+	/** NAPOT order of the mapping in each entry */
+	unsigned long order[SBI_SMEPMP_SADDR_SLOTS];
+	/** Bitmask of entries holding a mapping */
+	unsigned long live;
+	/** Entries mapped and not unmapped yet, innermost last */
+	u8 busy[SBI_SMEPMP_SADDR_SLOTS];
+	/** Number of entries in busy */
+	u8 busy_count;
+	/** Number of entries usable for mappings */
+	u8 count;
+	/** Next entry to replace when all of them are live */
+	u8 next;
+};
+
+static unsigned long hart_saddr_offset;
+
 static void mstatus_init(struct sbi_scratch *scratch)
 {
 	int cidx;
@@ -370,6 +391,36 @@ static void sbi_hart_smepmp_set(struct sbi_scratch *scratch,
 	}
 }
 
+/*
+ * Use the PMP entries which no domain needs for shared memory mappings,
+ * so that the entry layout is the same for all domains of the HART.
+ */
+static void hart_saddr_setup(struct hart_saddr *hs, unsigned int pmp_count)
+{
+	unsigned int i, count, max_count = 0;
+	struct sbi_domain_memregion *reg;
+	struct sbi_domain *dom;
+
+	sbi_domain_for_each(dom) {
+		count = 0;
+		sbi_domain_for_each_memregion(dom, reg)
+			count++;
+		max_count = MAX(max_count, count);
+	}
+
+	count = 1;
+	if (pmp_count > max_count + 1)
+		count = MIN(pmp_count - max_count, SBI_SMEPMP_SADDR_SLOTS);
+
+	for (i = 0; i < MAX(count, hs->count); i++)
+		pmp_disable(SBI_SMEPMP_RESV_ENTRY + i);
+
+	hs->count = count;
+	hs->live = 0;
+	hs->busy_count = 0;
+	hs->next = 0;
+}
+
 static int sbi_hart_smepmp_configure(struct sbi_scratch *scratch,
 				     unsigned int pmp_count,
 				     unsigned int pmp_log2gran,
@@ -377,7 +428,9 @@ static int sbi_hart_smepmp_configure(struct sbi_scratch *scratch,
 {
 	struct sbi_domain_memregion *reg;
 	struct sbi_domain *dom = sbi_domain_thishart_ptr();
-	unsigned int pmp_idx, pmp_flags;
+	struct hart_saddr *hs = sbi_scratch_offset_ptr(scratch,
+						       hart_saddr_offset);
+	unsigned int pmp_idx, pmp_flags, saddr_end;
 
 	/*
 	 * Set the RLB so that, we can write to PMP entries without
@@ -385,15 +438,16 @@ static int sbi_hart_smepmp_configure(struct sbi_scratch *scratch,
 	 */
 	csr_set(CSR_MSECCFG, MSECCFG_RLB);
 
-	/* Disable the reserved entry */
-	pmp_disable(SBI_SMEPMP_RESV_ENTRY);
+	/* Disable the reserved entries */
+	hart_saddr_setup(hs, pmp_count);
+	saddr_end = SBI_SMEPMP_RESV_ENTRY + hs->count;
 
 	/* Program M-only regions when MML is not set. */
 	pmp_idx = 0;
 	sbi_domain_for_each_memregion(dom, reg) {
-		/* Skip reserved entry */
-		if (pmp_idx == SBI_SMEPMP_RESV_ENTRY)
-			pmp_idx++;
+		/* Skip reserved entries */
+		if (pmp_idx < saddr_end)
+			pmp_idx = saddr_end;
 		if (pmp_count <= pmp_idx)
 			break;
 
@@ -417,9 +471,9 @@ static int sbi_hart_smepmp_configure(struct sbi_scratch *scratch,
 	/* Program shared and SU-only regions */
 	pmp_idx = 0;
 	sbi_domain_for_each_memregion(dom, reg) {
-		/* Skip reserved entry */
-		if (pmp_idx == SBI_SMEPMP_RESV_ENTRY)
-			pmp_idx++;
+		/* Skip reserved entries */
+		if (pmp_idx < saddr_end)
+			pmp_idx = saddr_end;
 		if (pmp_count <= pmp_idx)
 			break;
 
@@ -494,31 +548,55 @@ int sbi_hart_map_saddr(unsigned long addr, unsigned long size)
 {
 	/* shared R/W access for M and S/U mode */
 	unsigned int pmp_flags = (PMP_W | PMP_X);
-	unsigned long order, base = 0;
+	unsigned long order, base, last;
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct hart_saddr *hs;
+	unsigned int i;
 
 	/* If Smepmp is not supported no special mapping is required */
 	if (!sbi_hart_has_extension(scratch, SBI_HART_EXT_SMEPMP))
 		return SBI_OK;
 
-	if (is_pmp_entry_mapped(SBI_SMEPMP_RESV_ENTRY))
+	hs = sbi_scratch_offset_ptr(scratch, hart_saddr_offset);
+	if (hs->count <= hs->busy_count)
 		return SBI_ENOSPC;
 
-	for (order = MAX(sbi_hart_pmp_log2gran(scratch), log2roundup(size));
-	     order <= __riscv_xlen; order++) {
-		if (order < __riscv_xlen) {
-			base = addr & ~((1UL << order) - 1UL);
-			if ((base <= addr) &&
-			    (addr < (base + (1UL << order))) &&
-			    (base <= (addr + size - 1UL)) &&
-			    ((addr + size - 1UL) < (base + (1UL << order))))
-				break;
-		} else {
-			return SBI_EFAIL;
+	/* Smallest NAPOT region containing both ends of the range */
+	last = addr + (size ? size - 1 : 0);
+	order = (addr ^ last) ? sbi_fls(addr ^ last) + 1 : 0;
+	order = MAX(order, (unsigned long)sbi_hart_pmp_log2gran(scratch));
+	if (__riscv_xlen <= order)
+		return SBI_EFAIL;
+	base = addr & ~((1UL << order) - 1UL);
+
+	/* Reuse an entry which already maps the range */
+	for (i = 0; i < hs->count; i++) {
+		if ((hs->live & BIT(i)) && order <= hs->order[i] &&
+		    !((base ^ hs->base[i]) >> hs->order[i])) {
+			hs->busy[hs->busy_count++] = i;
+			sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SADDR_CACHE_HIT);
+			return SBI_OK;
 		}
 	}
 
-	pmp_set(SBI_SMEPMP_RESV_ENTRY, pmp_flags, base, order);
+	/* Take a free entry, or else replace one which is not in use */
+	for (i = 0; i < hs->count; i++) {
+		if (!(hs->live & BIT(i)))
+			break;
+	}
+	while (i == hs->count) {
+		i = hs->next;
+		hs->next = (hs->next + 1) % hs->count;
+		if (sbi_memchr(hs->busy, i, hs->busy_count))
+			i = hs->count;
+	}
+
+	pmp_set(SBI_SMEPMP_RESV_ENTRY + i, pmp_flags, base, order);
+	hs->base[i] = base;
+	hs->order[i] = order;
+	hs->live |= BIT(i);
+	hs->busy[hs->busy_count++] = i;
+	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SADDR_CACHE_MISS);
 
 	return SBI_OK;
 }
@@ -526,11 +604,40 @@ int sbi_hart_map_saddr(unsigned long addr, unsigned long size)
 int sbi_hart_unmap_saddr(void)
 {
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct hart_saddr *hs;
 
 	if (!sbi_hart_has_extension(scratch, SBI_HART_EXT_SMEPMP))
 		return SBI_OK;
 
-	return pmp_disable(SBI_SMEPMP_RESV_ENTRY);
+	/* The entry stays programmed until sbi_hart_saddr_flush() */
+	hs = sbi_scratch_offset_ptr(scratch, hart_saddr_offset);
+	if (hs->busy_count)
+		hs->busy_count--;
+
+	return SBI_OK;
+}
+
+void sbi_hart_saddr_flush(void)
+{
+	struct hart_saddr *hs;
+	unsigned int i;
+
+	if (!hart_saddr_offset)
+		return;
+
+	hs = sbi_scratch_thishart_offset_ptr(hart_saddr_offset);
+	if (!hs->live)
+		return;
+
+	/* Mappings which were not unmapped yet stay usable */
+	for (i = 0; i < hs->count; i++) {
+		if (!(hs->live & BIT(i)) ||
+		    sbi_memchr(hs->busy, i, hs->busy_count))
+			continue;
+
+		pmp_disable(SBI_SMEPMP_RESV_ENTRY + i);
+		hs->live &= ~BIT(i);
+	}
 }
 
 int sbi_hart_pmp_configure(struct sbi_scratch *scratch)
@@ -554,6 +661,13 @@ int sbi_hart_pmp_configure(struct sbi_scratch *scratch)
 		rc = sbi_hart_oldpmp_configure(scratch, pmp_count,
 						pmp_log2gran, pmp_addr_max);
 
+	sbi_hart_pmp_fence();
+
+	return rc;
+}
+
+void sbi_hart_pmp_fence(void)
+{
 	/*
 	 * As per section 3.7.2 of privileged specification v1.12,
 	 * virtual address translations can be speculatively performed
@@ -574,8 +688,6 @@ int sbi_hart_pmp_configure(struct sbi_scratch *scratch)
 		if (misa_extension('H'))
 			__sbi_hfence_gvma_all();
 	}
-
-	return rc;
 }
 
 int sbi_hart_priv_version(struct sbi_scratch *scratch)
@@ -689,6 +801,7 @@ const struct sbi_hart_ext_data sbi_hart_ext[] = {
 	__SBI_HART_EXT_DATA(zicfilp, SBI_HART_EXT_ZICFILP),
 	__SBI_HART_EXT_DATA(zicfiss, SBI_HART_EXT_ZICFISS),
 	__SBI_HART_EXT_DATA(ssdbltrp, SBI_HART_EXT_SSDBLTRP),
+	__SBI_HART_EXT_DATA(zbb, SBI_HART_EXT_ZBB),
 };
 
 _Static_assert(SBI_HART_EXT_MAX == array_size(sbi_hart_ext),
@@ -887,7 +1000,6 @@ __pmp_skip:
 #undef __check_csr_2
 #undef __check_csr
 
-
 #define __check_priv(__csr, __base_priv, __priv)			\
 	val = csr_read_allowed(__csr, &trap);				\
 	if (!trap.cause && (hfeatures->priv_version >= __base_priv)) {	\
@@ -990,8 +1102,53 @@ int sbi_hart_reinit(struct sbi_scratch *scratch)
 	return 0;
 }
 
+/* Vector registers are saved around vector copies so keep VLEN small */
+#define HART_STRING_VEC_MAX_VLENB	64
+
+static int hart_string_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct sbi_string_hart *sh;
+	unsigned long flags = 0;
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+	unsigned long mstatus, vlenb;
+#endif
+
+	if (cold_boot) {
+		sbi_string_hart_offset =
+			sbi_scratch_alloc_type_offset(struct sbi_string_hart);
+		if (!sbi_string_hart_offset)
+			return SBI_ENOMEM;
+	}
+
+	sh = sbi_scratch_offset_ptr(scratch, sbi_string_hart_offset);
+
+	if (sbi_hart_has_extension(scratch, SBI_HART_EXT_ZBB))
+		flags |= SBI_STRING_HART_ZBB;
+
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+	if (misa_extension('V')) {
+		/* Called before mstatus_init() so VS may still be off */
+		mstatus = csr_read_set(CSR_MSTATUS, MSTATUS_VS);
+		vlenb = csr_read(CSR_VLENB);
+		csr_write(CSR_MSTATUS, mstatus);
+
+		if (vlenb <= HART_STRING_VEC_MAX_VLENB) {
+			if (!sh->vsave)
+				sh->vsave = sbi_malloc(8 * vlenb);
+			if (sh->vsave)
+				flags |= SBI_STRING_HART_VECTOR;
+		}
+	}
+#endif
+
+	sh->flags = flags;
+
+	return 0;
+}
+
 int sbi_hart_init(struct sbi_scratch *scratch, bool cold_boot)
 {
+	struct hart_saddr *hs;
 	int rc;
 
 	/*
@@ -1008,17 +1165,33 @@ int sbi_hart_init(struct sbi_scratch *scratch, bool cold_boot)
 					sizeof(struct sbi_hart_features));
 		if (!hart_features_offset)
 			return SBI_ENOMEM;
+
+		hart_saddr_offset =
+			sbi_scratch_alloc_type_offset(struct hart_saddr);
+		if (!hart_saddr_offset)
+			return SBI_ENOMEM;
 	}
 
 	rc = hart_detect_features(scratch);
 	if (rc)
 		return rc;
 
+	/* Only the reserved entry until the PMP entries are configured */
+	hs = sbi_scratch_offset_ptr(scratch, hart_saddr_offset);
+	if (!hs->count)
+		hs->count = 1;
+
+	rc = hart_string_init(scratch, cold_boot);
+	if (rc)
+		return rc;
+
 	return sbi_hart_reinit(scratch);
 }
 
 void __attribute__((noreturn)) sbi_hart_hang(void)
 {
+	sbi_console_flush();
+
 	while (1)
 		wfi();
 	__builtin_unreachable();
@@ -8,6 +8,7 @@
  */
 
 #include <sbi/riscv_locks.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_list.h>
@@ -18,10 +19,60 @@
 #define HEAP_ALLOC_ALIGN		64
 #define HEAP_HOUSEKEEPING_FACTOR	16
 
-struct heap_node {
+/*
+ * The heap is managed in granules of HEAP_ALLOC_ALIGN bytes. The
+ * housekeeping area holds one tag per granule which describes the
+ * block starting at that granule:
+ *  - free block: number of granules, set on its first and last granule
+ *  - used block: number of granules | HEAP_TAG_USED on its first granule
+ *  - slab: granule offset from the slab start | HEAP_TAG_SLAB on all
+ *    granules of the slab
+ *  - zero for all other granules
+ * This allows sbi_free() to find the size of any allocation and both
+ * neighbours of a freed block without searching.
+ */
+#define HEAP_GRANULE_SHIFT		6
+#define HEAP_TAG_USED			0x1
+#define HEAP_TAG_SLAB			0x2
+#define HEAP_TAG_FLAGS			(HEAP_TAG_USED | HEAP_TAG_SLAB)
+#define HEAP_TAG_SHIFT			2
+
+/* Free blocks are binned by log2 of their number of granules */
+#define HEAP_NUM_BINS			32
+
+/*
+ * Allocations of up to HEAP_SLAB_MAX_SIZE bytes with the default
+ * alignment are served from slabs of HEAP_SLAB_SIZE bytes holding
+ * objects of one size class each.
+ */
+#define HEAP_SLAB_SIZE			2048
+#define HEAP_SLAB_GRANULES		(HEAP_SLAB_SIZE >> HEAP_GRANULE_SHIFT)
+#define HEAP_SLAB_CLASSES		3
+#define HEAP_SLAB_MAX_SIZE		(HEAP_ALLOC_ALIGN << (HEAP_SLAB_CLASSES - 1))
+
+/* Number of free slab objects kept by each HART per size class */
+#define HEAP_HART_CACHE_DEPTH		8
+
+_Static_assert(HEAP_ALLOC_ALIGN == (1 << HEAP_GRANULE_SHIFT),
+	       "HEAP_GRANULE_SHIFT does not match HEAP_ALLOC_ALIGN");
+
+struct heap_free_block {
 	struct sbi_dlist head;
-	unsigned long addr;
-	unsigned long size;
+};
+
+struct heap_slab {
+	/* Node in the partial slab list of the size class */
+	struct sbi_dlist head;
+	/* Singly linked list of free objects */
+	void *free_objs;
+	u32 class;
+	u32 nfree;
+	u32 nobjs;
+};
+
+struct heap_hart_cache {
+	u32 count[HEAP_SLAB_CLASSES];
+	void *objs[HEAP_SLAB_CLASSES][HEAP_HART_CACHE_DEPTH];
 };
 
 struct sbi_heap_control {
@@ -30,93 +81,319 @@ struct sbi_heap_control {
 	unsigned long size;
 	unsigned long hkbase;
 	unsigned long hksize;
-	struct sbi_dlist free_node_list;
-	struct sbi_dlist free_space_list;
-	struct sbi_dlist used_space_list;
+	/* Start and number of granules of the allocatable area */
+	unsigned long data;
+	unsigned long ngranules;
+	u32 *tags;
+	struct sbi_dlist bins[HEAP_NUM_BINS];
+	struct sbi_dlist slabs[HEAP_SLAB_CLASSES];
+	/* Bytes in free blocks and in free slab objects */
+	unsigned long free_bytes;
+	unsigned long slab_free_bytes;
+	unsigned long peak_used_bytes;
+	/* Optional per-HART slab object caches indexed by HART index */
+	struct heap_hart_cache *hart_caches;
+	u32 num_hart_caches;
 };
 
 struct sbi_heap_control global_hpctrl;
 
-static void *alloc_with_align(struct sbi_heap_control *hpctrl,
-			      size_t align, size_t size)
+static inline unsigned long heap_granule_addr(struct sbi_heap_control *hpctrl,
+					      unsigned long g)
 {
-	void *ret = NULL;
-	struct heap_node *n, *np, *rem;
-	unsigned long lowest_aligned;
-	size_t pad;
+	return hpctrl->data + (g << HEAP_GRANULE_SHIFT);
+}
 
-	if (!size)
-		return NULL;
+static inline unsigned long heap_addr_granule(struct sbi_heap_control *hpctrl,
+					      unsigned long addr)
+{
+	return (addr - hpctrl->data) >> HEAP_GRANULE_SHIFT;
+}
+
+static inline bool heap_tag_is_free(u32 tag)
+{
+	return tag && !(tag & HEAP_TAG_FLAGS);
+}
 
-	size += align - 1;
-	size &= ~((unsigned long)align - 1);
+static inline u32 heap_bin(unsigned long n)
+{
+	return MIN(sbi_fls(n), (unsigned long)HEAP_NUM_BINS - 1);
+}
 
-	spin_lock(&hpctrl->lock);
+static void heap_update_peak(struct sbi_heap_control *hpctrl)
+{
+	unsigned long used = (hpctrl->ngranules << HEAP_GRANULE_SHIFT) -
+			     hpctrl->free_bytes - hpctrl->slab_free_bytes;
 
-	np = NULL;
-	sbi_list_for_each_entry(n, &hpctrl->free_space_list, head) {
-		lowest_aligned = ROUNDUP(n->addr, align);
-		pad = lowest_aligned - n->addr;
+	if (hpctrl->peak_used_bytes < used)
+		hpctrl->peak_used_bytes = used;
+}
+
+/* Add a free block to its bin keeping the bin in address order */
+static void heap_bin_insert(struct sbi_heap_control *hpctrl,
+			    unsigned long g, unsigned long n)
+{
+	struct heap_free_block *fb, *pos;
+	struct sbi_dlist *bin = &hpctrl->bins[heap_bin(n)];
 
-		if (size + pad <= n->size) {
-			np = n;
+	hpctrl->tags[g] = n << HEAP_TAG_SHIFT;
+	hpctrl->tags[g + n - 1] = n << HEAP_TAG_SHIFT;
+	hpctrl->free_bytes += n << HEAP_GRANULE_SHIFT;
+
+	fb = (struct heap_free_block *)heap_granule_addr(hpctrl, g);
+	sbi_list_for_each_entry(pos, bin, head) {
+		if ((unsigned long)fb < (unsigned long)pos)
 			break;
+	}
+	sbi_list_add_tail(&fb->head, &pos->head);
+}
+
+static void heap_bin_remove(struct sbi_heap_control *hpctrl,
+			    unsigned long g, unsigned long n)
+{
+	struct heap_free_block *fb;
+
+	fb = (struct heap_free_block *)heap_granule_addr(hpctrl, g);
+	sbi_list_del(&fb->head);
+
+	hpctrl->tags[g] = 0;
+	hpctrl->tags[g + n - 1] = 0;
+	hpctrl->free_bytes -= n << HEAP_GRANULE_SHIFT;
+}
+
+/*
+ * Allocate n granules aligned to align bytes using address ordered first
+ * fit starting with the smallest bin which may hold a large enough block.
+ * Returns the first granule of the block or -1UL.
+ */
+static unsigned long heap_block_alloc(struct sbi_heap_control *hpctrl,
+				      unsigned long n, unsigned long align)
+{
+	unsigned long g, fn, pad, addr;
+	struct heap_free_block *fb;
+	u32 bin;
+
+	for (bin = heap_bin(n); bin < HEAP_NUM_BINS; bin++) {
+		sbi_list_for_each_entry(fb, &hpctrl->bins[bin], head) {
+			addr = (unsigned long)fb;
+			g = heap_addr_granule(hpctrl, addr);
+			fn = hpctrl->tags[g] >> HEAP_TAG_SHIFT;
+			pad = (ROUNDUP(addr, align) - addr) >> HEAP_GRANULE_SHIFT;
+			if (fn < pad + n)
+				continue;
+
+			heap_bin_remove(hpctrl, g, fn);
+			if (pad)
+				heap_bin_insert(hpctrl, g, pad);
+			if (fn - pad - n)
+				heap_bin_insert(hpctrl, g + pad + n,
+						fn - pad - n);
+
+			return g + pad;
 		}
 	}
-	if (!np)
-		goto out;
 
-	if (pad) {
-		if (sbi_list_empty(&hpctrl->free_node_list)) {
-			goto out;
+	return -1UL;
+}
+
+/* Free a block of n granules and merge it with free neighbours */
+static void heap_block_free(struct sbi_heap_control *hpctrl,
+			    unsigned long g, unsigned long n)
+{
+	unsigned long nn;
+	u32 tag;
+
+	hpctrl->tags[g] = 0;
+
+	if (g + n < hpctrl->ngranules) {
+		tag = hpctrl->tags[g + n];
+		if (heap_tag_is_free(tag)) {
+			nn = tag >> HEAP_TAG_SHIFT;
+			heap_bin_remove(hpctrl, g + n, nn);
+			n += nn;
 		}
+	}
 
-		n = sbi_list_first_entry(&hpctrl->free_node_list,
-					 struct heap_node, head);
-		sbi_list_del(&n->head);
-
-		if ((size + pad < np->size) &&
-		    !sbi_list_empty(&hpctrl->free_node_list)) {
-			rem = sbi_list_first_entry(&hpctrl->free_node_list,
-						   struct heap_node, head);
-			sbi_list_del(&rem->head);
-			rem->addr = np->addr + (size + pad);
-			rem->size = np->size - (size + pad);
-			sbi_list_add_tail(&rem->head,
-					  &hpctrl->free_space_list);
-		} else if (size + pad != np->size) {
-			/* Can't allocate, return n */
-			sbi_list_add(&n->head, &hpctrl->free_node_list);
-			ret = NULL;
-			goto out;
+	if (g) {
+		tag = hpctrl->tags[g - 1];
+		if (heap_tag_is_free(tag)) {
+			nn = tag >> HEAP_TAG_SHIFT;
+			heap_bin_remove(hpctrl, g - nn, nn);
+			g -= nn;
+			n += nn;
 		}
+	}
+
+	heap_bin_insert(hpctrl, g, n);
+}
+
+static inline unsigned long heap_slab_obj_size(u32 class)
+{
+	return (unsigned long)HEAP_ALLOC_ALIGN << class;
+}
+
+static u32 heap_slab_class(size_t size)
+{
+	u32 class = 0;
 
-		n->addr = lowest_aligned;
-		n->size = size;
-		sbi_list_add_tail(&n->head, &hpctrl->used_space_list);
+	while (heap_slab_obj_size(class) < size)
+		class++;
 
-		np->size = pad;
-		ret = (void *)n->addr;
+	return class;
+}
+
+static struct heap_slab *heap_slab_create(struct sbi_heap_control *hpctrl,
+					  u32 class)
+{
+	unsigned long g, i, obj, size = heap_slab_obj_size(class);
+	struct heap_slab *slab;
+
+	g = heap_block_alloc(hpctrl, HEAP_SLAB_GRANULES, HEAP_ALLOC_ALIGN);
+	if (g == -1UL)
+		return NULL;
+
+	for (i = 0; i < HEAP_SLAB_GRANULES; i++)
+		hpctrl->tags[g + i] = (i << HEAP_TAG_SHIFT) | HEAP_TAG_SLAB;
+
+	/* The slab header takes the first granule */
+	slab = (struct heap_slab *)heap_granule_addr(hpctrl, g);
+	slab->class = class;
+	slab->nobjs = (HEAP_SLAB_SIZE - HEAP_ALLOC_ALIGN) / size;
+	slab->nfree = slab->nobjs;
+	slab->free_objs = NULL;
+	for (i = slab->nobjs; i > 0; i--) {
+		obj = (unsigned long)slab + HEAP_ALLOC_ALIGN + (i - 1) * size;
+		*(void **)obj = slab->free_objs;
+		slab->free_objs = (void *)obj;
+	}
+	sbi_list_add(&slab->head, &hpctrl->slabs[class]);
+
+	/* Only the objects are free space, the rest is slab overhead */
+	hpctrl->slab_free_bytes += slab->nobjs * size;
+
+	return slab;
+}
+
+static void heap_slab_destroy(struct sbi_heap_control *hpctrl,
+			      struct heap_slab *slab)
+{
+	unsigned long i, g = heap_addr_granule(hpctrl, (unsigned long)slab);
+
+	sbi_list_del(&slab->head);
+	hpctrl->slab_free_bytes -= slab->nobjs *
+				   heap_slab_obj_size(slab->class);
+
+	for (i = 1; i < HEAP_SLAB_GRANULES; i++)
+		hpctrl->tags[g + i] = 0;
+	heap_block_free(hpctrl, g, HEAP_SLAB_GRANULES);
+}
+
+static void *heap_slab_alloc(struct sbi_heap_control *hpctrl, u32 class)
+{
+	struct heap_slab *slab;
+	void *obj;
+
+	if (sbi_list_empty(&hpctrl->slabs[class])) {
+		slab = heap_slab_create(hpctrl, class);
+		if (!slab)
+			return NULL;
 	} else {
-		if ((size < np->size) &&
-		    !sbi_list_empty(&hpctrl->free_node_list)) {
-			n = sbi_list_first_entry(&hpctrl->free_node_list,
-						 struct heap_node, head);
-			sbi_list_del(&n->head);
-			n->addr = np->addr;
-			n->size = size;
-			np->addr += size;
-			np->size -= size;
-			sbi_list_add_tail(&n->head, &hpctrl->used_space_list);
-			ret = (void *)n->addr;
-		} else if (size == np->size) {
-			sbi_list_del(&np->head);
-			sbi_list_add_tail(&np->head, &hpctrl->used_space_list);
-			ret = (void *)np->addr;
-		}
+		slab = sbi_list_first_entry(&hpctrl->slabs[class],
+					    struct heap_slab, head);
 	}
 
+	obj = slab->free_objs;
+	slab->free_objs = *(void **)obj;
+	slab->nfree--;
+	hpctrl->slab_free_bytes -= heap_slab_obj_size(class);
+
+	/* Only slabs with free objects stay on the partial list */
+	if (!slab->nfree)
+		sbi_list_del_init(&slab->head);
+
+	return obj;
+}
+
+static struct heap_slab *heap_obj_slab(struct sbi_heap_control *hpctrl,
+				       unsigned long g)
+{
+	g -= hpctrl->tags[g] >> HEAP_TAG_SHIFT;
+	return (struct heap_slab *)heap_granule_addr(hpctrl, g);
+}
+
+static void heap_slab_free(struct sbi_heap_control *hpctrl,
+			   struct heap_slab *slab, void *obj)
+{
+	struct sbi_dlist *partial = &hpctrl->slabs[slab->class];
+
+	*(void **)obj = slab->free_objs;
+	slab->free_objs = obj;
+	slab->nfree++;
+	hpctrl->slab_free_bytes += heap_slab_obj_size(slab->class);
+
+	if (slab->nfree == 1)
+		sbi_list_add(&slab->head, partial);
+
+	/* Return empty slabs unless this is the last one of its class */
+	if (slab->nfree == slab->nobjs &&
+	    (partial->next != &slab->head || partial->prev != &slab->head))
+		heap_slab_destroy(hpctrl, slab);
+}
+
+static struct heap_hart_cache *heap_hart_cache(struct sbi_heap_control *hpctrl)
+{
+	u32 hartindex;
+
+	if (!hpctrl->hart_caches)
+		return NULL;
+
+	hartindex = current_hartindex();
+	if (hpctrl->num_hart_caches <= hartindex)
+		return NULL;
+
+	return &hpctrl->hart_caches[hartindex];
+}
+
+static void *alloc_with_align(struct sbi_heap_control *hpctrl,
+			      size_t align, size_t size)
+{
+	struct heap_hart_cache *cache;
+	unsigned long g, n;
+	void *ret = NULL;
+	u32 class;
+
+	if (!size)
+		return NULL;
+
+	if (align == HEAP_ALLOC_ALIGN && size <= HEAP_SLAB_MAX_SIZE) {
+		class = heap_slab_class(size);
+
+		cache = heap_hart_cache(hpctrl);
+		if (cache && cache->count[class])
+			return cache->objs[class][--cache->count[class]];
+
+		spin_lock(&hpctrl->lock);
+		ret = heap_slab_alloc(hpctrl, class);
+		goto out;
+	}
+
+	if (size > (hpctrl->ngranules << HEAP_GRANULE_SHIFT))
+		return NULL;
+
+	n = ROUNDUP(size, align) >> HEAP_GRANULE_SHIFT;
+
+	spin_lock(&hpctrl->lock);
+
+	g = heap_block_alloc(hpctrl, n, align);
+	if (g == -1UL)
+		goto out;
+
+	hpctrl->tags[g] = (n << HEAP_TAG_SHIFT) | HEAP_TAG_USED;
+	ret = (void *)heap_granule_addr(hpctrl, g);
+
 out:
+	if (ret)
+		heap_update_peak(hpctrl);
 	spin_unlock(&hpctrl->lock);
 
 	return ret;
@@ -155,60 +432,54 @@ void *sbi_zalloc_from(struct sbi_heap_control *hpctrl, size_t size)
 
 void sbi_free_from(struct sbi_heap_control *hpctrl, void *ptr)
 {
-	struct heap_node *n, *np;
+	unsigned long g, addr = (unsigned long)ptr;
+	struct heap_hart_cache *cache;
+	struct heap_slab *slab;
+	u32 tag, class;
 
-	if (!ptr)
+	if (!ptr || addr < hpctrl->data ||
+	    addr >= heap_granule_addr(hpctrl, hpctrl->ngranules))
 		return;
 
-	spin_lock(&hpctrl->lock);
-
-	np = NULL;
-	sbi_list_for_each_entry(n, &hpctrl->used_space_list, head) {
-		if ((n->addr <= (unsigned long)ptr) &&
-		    ((unsigned long)ptr < (n->addr + n->size))) {
-			np = n;
-			break;
+	g = heap_addr_granule(hpctrl, addr);
+
+	/*
+	 * The tag of a slab granule does not change while any object of
+	 * the slab is allocated so it is safe to check it without lock.
+	 */
+	tag = hpctrl->tags[g];
+	if (tag & HEAP_TAG_SLAB) {
+		slab = heap_obj_slab(hpctrl, g);
+		class = slab->class;
+
+		cache = heap_hart_cache(hpctrl);
+		if (cache && cache->count[class] < HEAP_HART_CACHE_DEPTH) {
+			cache->objs[class][cache->count[class]++] = ptr;
+			return;
 		}
-	}
-	if (!np) {
+
+		spin_lock(&hpctrl->lock);
+		heap_slab_free(hpctrl, slab, ptr);
 		spin_unlock(&hpctrl->lock);
 		return;
 	}
 
-	sbi_list_del(&np->head);
+	spin_lock(&hpctrl->lock);
 
-	sbi_list_for_each_entry(n, &hpctrl->free_space_list, head) {
-		if ((np->addr + np->size) == n->addr) {
-			n->addr = np->addr;
-			n->size += np->size;
-			sbi_list_add_tail(&np->head, &hpctrl->free_node_list);
-			np = NULL;
-			break;
-		} else if (np->addr == (n->addr + n->size)) {
-			n->size += np->size;
-			sbi_list_add_tail(&np->head, &hpctrl->free_node_list);
-			np = NULL;
-			break;
-		} else if ((n->addr + n->size) < np->addr) {
-			sbi_list_add(&np->head, &n->head);
-			np = NULL;
-			break;
-		}
-	}
-	if (np)
-		sbi_list_add_tail(&np->head, &hpctrl->free_space_list);
+	/* Ignore pointers which are not the start of an allocation */
+	tag = hpctrl->tags[g];
+	if ((tag & HEAP_TAG_FLAGS) == HEAP_TAG_USED)
+		heap_block_free(hpctrl, g, tag >> HEAP_TAG_SHIFT);
 
 	spin_unlock(&hpctrl->lock);
 }
 
 unsigned long sbi_heap_free_space_from(struct sbi_heap_control *hpctrl)
 {
-	struct heap_node *n;
 	unsigned long ret = 0;
 
 	spin_lock(&hpctrl->lock);
-	sbi_list_for_each_entry(n, &hpctrl->free_space_list, head)
-		ret += n->size;
+	ret = hpctrl->free_bytes + hpctrl->slab_free_bytes;
 	spin_unlock(&hpctrl->lock);
 
 	return ret;
@@ -216,7 +487,7 @@ unsigned long sbi_heap_free_space_from(struct sbi_heap_control *hpctrl)
 
 unsigned long sbi_heap_used_space_from(struct sbi_heap_control *hpctrl)
 {
-	return hpctrl->size - hpctrl->hksize - sbi_heap_free_space();
+	return hpctrl->size - hpctrl->hksize - sbi_heap_free_space_from(hpctrl);
 }
 
 unsigned long sbi_heap_reserved_space_from(struct sbi_heap_control *hpctrl)
@@ -224,44 +495,81 @@ unsigned long sbi_heap_reserved_space_from(struct sbi_heap_control *hpctrl)
 	return hpctrl->hksize;
 }
 
+unsigned long sbi_heap_peak_used_space_from(struct sbi_heap_control *hpctrl)
+{
+	unsigned long ret;
+
+	spin_lock(&hpctrl->lock);
+	ret = hpctrl->peak_used_bytes +
+	      (hpctrl->size - hpctrl->hksize -
+	       (hpctrl->ngranules << HEAP_GRANULE_SHIFT));
+	spin_unlock(&hpctrl->lock);
+
+	return ret;
+}
+
+unsigned long sbi_heap_largest_free_space_from(struct sbi_heap_control *hpctrl)
+{
+	struct heap_free_block *fb;
+	unsigned long n, ret = 0;
+	int bin;
+
+	spin_lock(&hpctrl->lock);
+	for (bin = HEAP_NUM_BINS - 1; bin >= 0 && !ret; bin--) {
+		sbi_list_for_each_entry(fb, &hpctrl->bins[bin], head) {
+			n = hpctrl->tags[heap_addr_granule(hpctrl,
+						(unsigned long)fb)];
+			n >>= HEAP_TAG_SHIFT;
+			ret = MAX(ret, n << HEAP_GRANULE_SHIFT);
+		}
+	}
+	spin_unlock(&hpctrl->lock);
+
+	return ret;
+}
+
 int sbi_heap_init_new(struct sbi_heap_control *hpctrl, unsigned long base,
 		       unsigned long size)
 {
-	unsigned long i;
-	struct heap_node *n;
+	u32 i;
 
 	/* Initialize heap control */
 	SPIN_LOCK_INIT(hpctrl->lock);
 	hpctrl->base = base;
 	hpctrl->size = size;
 	hpctrl->hkbase = hpctrl->base;
-	hpctrl->hksize = hpctrl->size / HEAP_HOUSEKEEPING_FACTOR;
-	hpctrl->hksize &= ~((unsigned long)HEAP_BASE_ALIGN - 1);
-	SBI_INIT_LIST_HEAD(&hpctrl->free_node_list);
-	SBI_INIT_LIST_HEAD(&hpctrl->free_space_list);
-	SBI_INIT_LIST_HEAD(&hpctrl->used_space_list);
-
-	/* Prepare free node list */
-	for (i = 0; i < (hpctrl->hksize / sizeof(*n)); i++) {
-		n = (struct heap_node *)(hpctrl->hkbase + (sizeof(*n) * i));
-		SBI_INIT_LIST_HEAD(&n->head);
-		n->addr = n->size = 0;
-		sbi_list_add_tail(&n->head, &hpctrl->free_node_list);
-	}
+	hpctrl->hksize = ROUNDUP(hpctrl->size / HEAP_HOUSEKEEPING_FACTOR,
+				 HEAP_BASE_ALIGN);
+	if (hpctrl->size <= hpctrl->hksize)
+		return SBI_EINVAL;
+
+	/* One tag per granule fits in the housekeeping area */
+	hpctrl->data = hpctrl->hkbase + hpctrl->hksize;
+	hpctrl->ngranules = (hpctrl->size - hpctrl->hksize) >> HEAP_GRANULE_SHIFT;
+	hpctrl->tags = (u32 *)hpctrl->hkbase;
+	sbi_memset(hpctrl->tags, 0, hpctrl->ngranules * sizeof(*hpctrl->tags));
+
+	for (i = 0; i < HEAP_NUM_BINS; i++)
+		SBI_INIT_LIST_HEAD(&hpctrl->bins[i]);
+	for (i = 0; i < HEAP_SLAB_CLASSES; i++)
+		SBI_INIT_LIST_HEAD(&hpctrl->slabs[i]);
 
-	/* Prepare free space list */
-	n = sbi_list_first_entry(&hpctrl->free_node_list,
-				 struct heap_node, head);
-	sbi_list_del(&n->head);
-	n->addr = hpctrl->hkbase + hpctrl->hksize;
-	n->size = hpctrl->size - hpctrl->hksize;
-	sbi_list_add_tail(&n->head, &hpctrl->free_space_list);
+	hpctrl->free_bytes = 0;
+	hpctrl->slab_free_bytes = 0;
+	hpctrl->peak_used_bytes = 0;
+	hpctrl->hart_caches = NULL;
+	hpctrl->num_hart_caches = 0;
+
+	/* The whole allocatable area starts as one free block */
+	heap_bin_insert(hpctrl, 0, hpctrl->ngranules);
 
 	return 0;
 }
 
 int sbi_heap_init(struct sbi_scratch *scratch)
 {
+	int rc;
+
 	/* Sanity checks on heap offset and size */
 	if (!scratch->fw_heap_size ||
 	    (scratch->fw_heap_size & (HEAP_BASE_ALIGN - 1)) ||
@@ -270,9 +578,23 @@ int sbi_heap_init(struct sbi_scratch *scratch)
 	    (scratch->fw_heap_offset & (HEAP_BASE_ALIGN - 1)))
 		return SBI_EINVAL;
 
-	return sbi_heap_init_new(&global_hpctrl,
-				  scratch->fw_start + scratch->fw_heap_offset,
-				  scratch->fw_heap_size);
+	rc = sbi_heap_init_new(&global_hpctrl,
+			       scratch->fw_start + scratch->fw_heap_offset,
+			       scratch->fw_heap_size);
+	if (rc)
+		return rc;
+
+#ifdef CONFIG_SBI_HEAP_HART_CACHE
+	/* Without caches every allocation simply takes the heap lock */
+	global_hpctrl.hart_caches =
+		sbi_zalloc(sizeof(struct heap_hart_cache) *
+			   (sbi_scratch_last_hartindex() + 1));
+	if (global_hpctrl.hart_caches)
+		global_hpctrl.num_hart_caches =
+			sbi_scratch_last_hartindex() + 1;
+#endif
+
+	return 0;
 }
 
 int sbi_heap_alloc_new(struct sbi_heap_control **hpctrl)
@@ -170,6 +170,8 @@ static void sbi_hsm_hart_wait(struct sbi_scratch *scratch)
 
 	/* Wait for state transition requested by sbi_hsm_hart_start() */
 	while (atomic_read(&hdata->state) != SBI_HSM_STATE_START_PENDING) {
+		/* Idle HARTs help write out buffered console output */
+		sbi_console_drain();
 		wfi();
 	}
 
@@ -391,6 +393,8 @@ int sbi_hsm_hart_stop(struct sbi_scratch *scratch, bool exitnow)
 
 static int __sbi_hsm_suspend_default(struct sbi_scratch *scratch)
 {
+	sbi_console_drain();
+
 	/* Wait for interrupt */
 	wfi();
 
@@ -26,6 +26,7 @@
 #include <sbi/sbi_dbtr.h>
 #include <sbi/sbi_mpxy.h>
 #include <sbi/sbi_sse.h>
+#include <sbi/sbi_stats.h>
 #include <sbi/sbi_system.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_timer.h>
@@ -132,6 +133,10 @@ static void sbi_boot_print_general(struct sbi_scratch *scratch)
 		   (u32)(sbi_heap_reserved_space() / 1024),
 		   (u32)(sbi_heap_used_space() / 1024),
 		   (u32)(sbi_heap_free_space() / 1024));
+	sbi_printf("Firmware Heap Usage         : "
+		   "%d KB (peak used), %d KB (largest free block)\n",
+		   (u32)(sbi_heap_peak_used_space() / 1024),
+		   (u32)(sbi_heap_largest_free_space() / 1024));
 	sbi_printf("Firmware Scratch Size       : "
 		   "%d B (total), %d B (used), %d B (free)\n",
 		   SBI_SCRATCH_SIZE,
@@ -193,6 +198,8 @@ static void sbi_boot_print_hart(struct sbi_scratch *scratch, u32 hartid)
 		   sbi_hart_mhpm_mask(scratch));
 	sbi_printf("Boot HART Debug Triggers    : %d triggers\n",
 		   sbi_dbtr_get_total_triggers());
+	sbi_tlb_get_flush_limits_str(scratch, str, sizeof(str));
+	sbi_printf("Boot HART TLB Flush Limits  : %s\n", str);
 	sbi_hart_delegation_dump(scratch, "Boot HART ", "           ");
 }
 
@@ -266,6 +273,14 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_stats_init(scratch, true);
+	if (rc)
+		sbi_hart_hang();
+
+	rc = sbi_console_init(scratch, true);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_sse_init(scratch, true);
 	if (rc) {
 		sbi_printf("%s: sse init failed (error %d)\n", __func__, rc);
@@ -379,6 +394,9 @@ static void __noreturn init_coldboot(struct sbi_scratch *scratch, u32 hartid)
 	count = sbi_scratch_offset_ptr(scratch, init_count_offset);
 	(*count)++;
 
+	/* Boot messages should be out before the next stage takes over */
+	sbi_console_flush();
+
 	sbi_hsm_hart_start_finish(scratch, hartid);
 }
 
@@ -408,6 +426,14 @@ static void __noreturn init_warm_startup(struct sbi_scratch *scratch,
 	if (rc)
 		sbi_hart_hang();
 
+	rc = sbi_stats_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
+	rc = sbi_console_init(scratch, false);
+	if (rc)
+		sbi_hart_hang();
+
 	rc = sbi_sse_init(scratch, false);
 	if (rc)
 		sbi_hart_hang();
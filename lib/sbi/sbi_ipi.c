@@ -37,7 +37,7 @@ static const struct sbi_ipi_device *ipi_dev = NULL;
 static const struct sbi_ipi_event_ops *ipi_ops_array[SBI_IPI_EVENT_MAX];
 
 static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartindex,
-			u32 event, void *data)
+			u32 event, void *data, struct sbi_hartmask *raw_mask)
 {
 	int ret = 0;
 	struct sbi_scratch *remote_scratch = NULL;
@@ -75,12 +75,13 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartindex,
 	 * trigger the interrupt.
 	 *
 	 * Multiple harts may be trying to send IPI to the
-	 * remote hart so call sbi_ipi_raw_send() only when
-	 * the ipi_type was previously zero.
+	 * remote hart so trigger the interrupt only when the
+	 * ipi_type was previously zero. The interrupt itself
+	 * is sent by the caller for all HARTs in raw_mask.
 	 */
 	if (!__atomic_fetch_or(&ipi_data->ipi_type,
 				BIT(event), __ATOMIC_RELAXED))
-		ret = sbi_ipi_raw_send(remote_hartindex);
+		sbi_hartmask_set_hartindex(remote_hartindex, raw_mask);
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_IPI_SENT);
 
@@ -109,10 +110,10 @@ static int sbi_ipi_sync(struct sbi_scratch *scratch, u32 event)
  */
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 {
-	int rc = 0;
+	int rc = 0, ret;
 	bool retry_needed;
 	ulong i;
-	struct sbi_hartmask target_mask;
+	struct sbi_hartmask target_mask, raw_mask;
 	struct sbi_domain *dom = sbi_domain_thishart_ptr();
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
 
@@ -135,16 +136,28 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 	/* Send IPIs */
 	do {
 		retry_needed = false;
+		sbi_hartmask_clear_all(&raw_mask);
 		sbi_hartmask_for_each_hartindex(i, &target_mask) {
-			rc = sbi_ipi_send(scratch, i, event, data);
+			rc = sbi_ipi_send(scratch, i, event, data, &raw_mask);
 			if (rc < 0)
-				goto done;
+				break;
 			if (rc == SBI_IPI_UPDATE_RETRY)
 				retry_needed = true;
 			else
 				sbi_hartmask_clear_hartindex(i, &target_mask);
 			rc = 0;
 		}
+
+		/*
+		 * Interrupt all HARTs updated in this pass at once and
+		 * before retrying so they can drain what they already
+		 * have queued.
+		 */
+		ret = sbi_ipi_raw_send_mask(&raw_mask);
+		if (!rc)
+			rc = ret;
+		if (rc)
+			goto done;
 	} while (retry_needed);
 
 done:
@@ -274,6 +287,30 @@ int sbi_ipi_raw_send(u32 hartindex)
 	return 0;
 }
 
+int sbi_ipi_raw_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i;
+
+	if (sbi_hartmask_empty(mask))
+		return 0;
+
+	if (!ipi_dev || !ipi_dev->ipi_send)
+		return SBI_EINVAL;
+
+	/* Same ordering requirements as sbi_ipi_raw_send() */
+	wmb();
+
+	if (ipi_dev->ipi_send_mask) {
+		ipi_dev->ipi_send_mask(mask);
+		return 0;
+	}
+
+	sbi_hartmask_for_each_hartindex(i, mask)
+		ipi_dev->ipi_send(i);
+
+	return 0;
+}
+
 void sbi_ipi_raw_clear(void)
 {
 	if (ipi_dev && ipi_dev->ipi_clear)
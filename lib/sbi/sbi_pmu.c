@@ -56,6 +56,17 @@ union sbi_pmu_ctr_info {
 #error "Can't handle firmware counters beyond BITS_PER_LONG"
 #endif
 
+#if SBI_PMU_CTR_MAX > 64
+#error "Can't handle counters beyond the PMU snapshot size"
+#endif
+
+/* Number of standard and OpenSBI specific firmware event codes */
+#define PMU_FW_EVENT_SLOTS						\
+	(SBI_PMU_FW_MAX + SBI_PMU_FW_IMPL_MAX - SBI_PMU_FW_IMPL_START)
+
+/* Snapshot shared memory address if none is set */
+#define PMU_SNAPSHOT_NONE	-1UL
+
 /** Per-HART state of the PMU counters */
 struct sbi_pmu_hart_state {
 	/* HART to which this state belongs */
@@ -72,6 +83,14 @@ struct sbi_pmu_hart_state {
 	 * and hence can optimally share the same memory.
 	 */
 	uint64_t fw_counters_data[SBI_PMU_FW_CTR_MAX];
+	/*
+	 * Firmware counter index plus one of the started counter which
+	 * counts each standard or OpenSBI specific firmware event, zero
+	 * if none does. Indexed by pmu_fw_event_slot().
+	 */
+	uint8_t fw_event_ctr[PMU_FW_EVENT_SLOTS];
+	/* Address of the snapshot shared memory */
+	unsigned long snapshot_addr;
 };
 
 /** Offset of pointer to PMU HART state in scratch space */
@@ -105,6 +124,89 @@ static uint32_t total_ctrs;
   (((x) & SBI_PMU_EVENT_IDX_TYPE_MASK) >> SBI_PMU_EVENT_IDX_TYPE_OFFSET)
 #define get_cidx_code(x) (x & SBI_PMU_EVENT_IDX_CODE_MASK)
 
+/* Check for a standard, OpenSBI specific or platform firmware event code */
+static inline bool pmu_fw_event_code_valid(uint32_t event_code)
+{
+	return event_code < SBI_PMU_FW_MAX ||
+	       (event_code >= SBI_PMU_FW_IMPL_START &&
+		event_code < SBI_PMU_FW_IMPL_MAX) ||
+	       event_code == SBI_PMU_FW_PLATFORM;
+}
+
+/* Index of a standard or OpenSBI specific firmware event in fw_event_ctr */
+static inline int pmu_fw_event_slot(uint32_t event_code)
+{
+	if (event_code < SBI_PMU_FW_MAX)
+		return event_code;
+	if (event_code >= SBI_PMU_FW_IMPL_START &&
+	    event_code < SBI_PMU_FW_IMPL_MAX)
+		return SBI_PMU_FW_MAX + event_code - SBI_PMU_FW_IMPL_START;
+
+	return -1;
+}
+
+/*
+ * Rebuild the firmware event to counter table after firmware counters
+ * were started, stopped or reassigned so that counting an event does
+ * not have to search the counters. As before, only the lowest started
+ * counter of an event counts it.
+ */
+static void pmu_fw_event_map_update(struct sbi_pmu_hart_state *phs)
+{
+	int i, slot;
+
+	sbi_memset(phs->fw_event_ctr, 0, sizeof(phs->fw_event_ctr));
+	for (i = SBI_PMU_FW_CTR_MAX - 1; i >= 0; i--) {
+		if (!(phs->fw_counters_started & BIT(i)))
+			continue;
+
+		slot = pmu_fw_event_slot(
+			get_cidx_code(phs->active_events[num_hw_ctrs + i]));
+		if (slot >= 0)
+			phs->fw_event_ctr[slot] = i + 1;
+	}
+}
+
+/*
+ * Write a value into the snapshot shared memory of this HART. This is
+ * skipped when all shared memory mapping entries of the HART are in use.
+ *
+ * As the SBI specification defines, the snapshot only holds counter
+ * values as of the last counter stop with SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT,
+ * relative to the counter index base of that call. Running firmware
+ * counters are not mirrored there, since that would map the shared memory
+ * on every firmware event.
+ */
+static void pmu_snapshot_store(struct sbi_pmu_hart_state *phs,
+			       unsigned long offset, uint64_t val)
+{
+	if (phs->snapshot_addr == PMU_SNAPSHOT_NONE ||
+	    sbi_hart_map_saddr(phs->snapshot_addr, SBI_PMU_SNAPSHOT_SIZE))
+		return;
+
+	*(uint64_t *)(phs->snapshot_addr + offset) = val;
+
+	sbi_hart_unmap_saddr();
+}
+
+static uint64_t pmu_snapshot_load(struct sbi_pmu_hart_state *phs,
+				  unsigned long offset)
+{
+	uint64_t val;
+
+	if (sbi_hart_map_saddr(phs->snapshot_addr, SBI_PMU_SNAPSHOT_SIZE))
+		return 0;
+
+	val = *(uint64_t *)(phs->snapshot_addr + offset);
+
+	sbi_hart_unmap_saddr();
+
+	return val;
+}
+
+#define pmu_snapshot_ctr_offset(__i)					\
+	offsetof(struct sbi_pmu_snapshot, ctr_values[(__i)])
+
 /**
  * Perform a sanity check on event & counter mappings with event range overlap check
  * @param evtA Pointer to the existing hw event structure
@@ -144,18 +246,17 @@ static int pmu_event_validate(struct sbi_pmu_hart_state *phs,
 		event_idx_code_max = SBI_PMU_HW_GENERAL_MAX;
 		break;
 	case SBI_PMU_EVENT_TYPE_FW:
-		if ((event_idx_code >= SBI_PMU_FW_MAX &&
-		    event_idx_code <= SBI_PMU_FW_RESERVED_MAX) ||
-		    event_idx_code > SBI_PMU_FW_PLATFORM)
+		if (!pmu_fw_event_code_valid(event_idx_code))
 			return SBI_EINVAL;
 
-		if (SBI_PMU_FW_PLATFORM == event_idx_code &&
-		    pmu_dev && pmu_dev->fw_event_validate_encoding)
-			return pmu_dev->fw_event_validate_encoding(phs->hartid,
-							           edata);
-		else
-			event_idx_code_max = SBI_PMU_FW_MAX;
-		break;
+		if (SBI_PMU_FW_PLATFORM == event_idx_code) {
+			if (pmu_dev && pmu_dev->fw_event_validate_encoding)
+				return pmu_dev->fw_event_validate_encoding(
+							phs->hartid, edata);
+			return SBI_EINVAL;
+		}
+
+		return event_idx_type;
 	case SBI_PMU_EVENT_TYPE_HW_CACHE:
 		cache_ops_result = event_idx_code &
 					SBI_PMU_EVENT_HW_CACHE_OPS_RESULT;
@@ -219,9 +320,7 @@ int sbi_pmu_ctr_fw_read(uint32_t cidx, uint64_t *cval)
 	if (event_idx_type != SBI_PMU_EVENT_TYPE_FW)
 		return SBI_EINVAL;
 
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	if (SBI_PMU_FW_PLATFORM == event_code) {
@@ -363,6 +462,35 @@ static void pmu_ctr_write_hw(uint32_t cidx, uint64_t ival)
 #endif
 }
 
+static uint64_t pmu_ctr_read_hw(uint32_t cidx)
+{
+#if __riscv_xlen == 32
+	uint32_t lo, hi;
+
+	do {
+		hi = csr_read_num(CSR_MCYCLEH + cidx);
+		lo = csr_read_num(CSR_MCYCLE + cidx);
+	} while (hi != csr_read_num(CSR_MCYCLEH + cidx));
+
+	return ((uint64_t)hi << 32) | lo;
+#else
+	return csr_read_num(CSR_MCYCLE + cidx);
+#endif
+}
+
+static bool pmu_ctr_overflown_hw(uint32_t cidx)
+{
+	if (cidx < 3 || !sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+						 SBI_HART_EXT_SSCOFPMF))
+		return false;
+
+#if __riscv_xlen == 32
+	return csr_read_num(CSR_MHPMEVENT3H + cidx - 3) & MHPMEVENTH_OF;
+#else
+	return csr_read_num(CSR_MHPMEVENT3 + cidx - 3) & MHPMEVENT_OF;
+#endif
+}
+
 static int pmu_ctr_start_hw(uint32_t cidx, uint64_t ival, bool ival_update)
 {
 	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
@@ -417,9 +545,7 @@ static int pmu_ctr_start_fw(struct sbi_pmu_hart_state *phs,
 			    uint64_t event_data, uint64_t ival,
 			    bool ival_update)
 {
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	if (SBI_PMU_FW_PLATFORM == event_code) {
@@ -443,6 +569,7 @@ static int pmu_ctr_start_fw(struct sbi_pmu_hart_state *phs,
 	}
 
 	phs->fw_counters_started |= BIT(cidx - num_hw_ctrs);
+	pmu_fw_event_map_update(phs);
 
 	return 0;
 }
@@ -465,8 +592,11 @@ int sbi_pmu_ctr_start(unsigned long cbase, unsigned long cmask,
 	if ((cbase + sbi_fls(cmask)) >= total_ctrs)
 		return ret;
 
-	if (flags & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT)
-		return SBI_ENO_SHMEM;
+	if (flags & SBI_PMU_START_FLAG_INIT_FROM_SNAPSHOT) {
+		if (phs->snapshot_addr == PMU_SNAPSHOT_NONE)
+			return SBI_ENO_SHMEM;
+		bUpdate = true;
+	}
 
 	if (flags & SBI_PMU_START_FLAG_SET_INIT_VALUE)
 		bUpdate = true;
@@ -477,7 +607,12 @@ int sbi_pmu_ctr_start(unsigned long cbase, unsigned long cmask,
 		if (event_idx_type < 0)
 			/* Continue the start operation for other counters */
 			continue;
-		else if (event_idx_type == SBI_PMU_EVENT_TYPE_FW) {
+
+		if (flags & SBI_PMU_START_FLAG_INIT_FROM_SNAPSHOT)
+			ival = pmu_snapshot_load(phs,
+						 pmu_snapshot_ctr_offset(i));
+
+		if (event_idx_type == SBI_PMU_EVENT_TYPE_FW) {
 			edata = (event_code == SBI_PMU_FW_PLATFORM) ?
 				 phs->fw_counters_data[cidx - num_hw_ctrs]
 				 : 0x0;
@@ -521,9 +656,7 @@ static int pmu_ctr_stop_fw(struct sbi_pmu_hart_state *phs,
 {
 	int ret;
 
-	if ((event_code >= SBI_PMU_FW_MAX &&
-	    event_code <= SBI_PMU_FW_RESERVED_MAX) ||
-	    event_code > SBI_PMU_FW_PLATFORM)
+	if (!pmu_fw_event_code_valid(event_code))
 		return SBI_EINVAL;
 
 	if (SBI_PMU_FW_PLATFORM == event_code &&
@@ -534,6 +667,7 @@ static int pmu_ctr_stop_fw(struct sbi_pmu_hart_state *phs,
 	}
 
 	phs->fw_counters_started &= ~BIT(cidx - num_hw_ctrs);
+	pmu_fw_event_map_update(phs);
 
 	return 0;
 }
@@ -565,12 +699,14 @@ int sbi_pmu_ctr_stop(unsigned long cbase, unsigned long cmask,
 	int ret = SBI_EINVAL;
 	int event_idx_type;
 	uint32_t event_code;
+	uint64_t overflow = 0, val;
 	int i, cidx;
 
 	if ((cbase + sbi_fls(cmask)) >= total_ctrs)
 		return SBI_EINVAL;
 
-	if (flag & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT)
+	if ((flag & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT) &&
+	    phs->snapshot_addr == PMU_SNAPSHOT_NONE)
 		return SBI_ENO_SHMEM;
 
 	for_each_set_bit(i, &cmask, BITS_PER_LONG) {
@@ -585,12 +721,29 @@ int sbi_pmu_ctr_stop(unsigned long cbase, unsigned long cmask,
 		else
 			ret = pmu_ctr_stop_hw(cidx);
 
+		if (flag & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT) {
+			if (event_idx_type == SBI_PMU_EVENT_TYPE_FW) {
+				if (sbi_pmu_ctr_fw_read(cidx, &val))
+					val = 0;
+			} else {
+				val = pmu_ctr_read_hw(cidx);
+				if (pmu_ctr_overflown_hw(cidx))
+					overflow |= BIT_ULL(i);
+			}
+			pmu_snapshot_store(phs, pmu_snapshot_ctr_offset(i),
+					   val);
+		}
+
 		if (cidx > (CSR_INSTRET - CSR_CYCLE) && flag & SBI_PMU_STOP_FLAG_RESET) {
 			phs->active_events[cidx] = SBI_PMU_EVENT_IDX_INVALID;
 			pmu_reset_hw_mhpmevent(cidx);
 		}
 	}
 
+	if (flag & SBI_PMU_STOP_FLAG_TAKE_SNAPSHOT)
+		pmu_snapshot_store(phs, offsetof(struct sbi_pmu_snapshot,
+						 ctr_overflow_mask), overflow);
+
 	/* Clear MIP_LCOFIP to avoid spurious interrupts */
 	if (phs->sse_enabled)
 		csr_clear(CSR_MIP, MIP_LCOFIP);
@@ -876,7 +1029,8 @@ skip_match:
 		if (flags & SBI_PMU_CFG_FLAG_AUTO_START)
 			pmu_ctr_start_hw(ctr_idx, 0, false);
 	} else if (event_type == SBI_PMU_EVENT_TYPE_FW) {
-		if (flags & SBI_PMU_CFG_FLAG_CLEAR_VALUE)
+		if ((flags & SBI_PMU_CFG_FLAG_CLEAR_VALUE) &&
+		    SBI_PMU_FW_PLATFORM != event_code)
 			phs->fw_counters_data[ctr_idx - num_hw_ctrs] = 0;
 		if (flags & SBI_PMU_CFG_FLAG_AUTO_START) {
 			if (SBI_PMU_FW_PLATFORM == event_code &&
@@ -889,6 +1043,7 @@ skip_match:
 			}
 			phs->fw_counters_started |= BIT(ctr_idx - num_hw_ctrs);
 		}
+		pmu_fw_event_map_update(phs);
 	}
 
 	return ctr_idx;
@@ -896,8 +1051,12 @@ skip_match:
 
 int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
 {
-	u32 cidx;
-	uint64_t *fcounter = NULL;
+	return sbi_pmu_ctr_add_fw(fw_id, 1);
+}
+
+int sbi_pmu_ctr_add_fw(enum sbi_pmu_fw_event_code_id fw_id, uint64_t val)
+{
+	u32 fw_idx;
 	struct sbi_pmu_hart_state *phs = pmu_thishart_state_ptr();
 
 	if (unlikely(!phs))
@@ -906,19 +1065,53 @@ int sbi_pmu_ctr_incr_fw(enum sbi_pmu_fw_event_code_id fw_id)
 	if (likely(!phs->fw_counters_started))
 		return 0;
 
-	if (unlikely(fw_id >= SBI_PMU_FW_MAX))
+	if (unlikely(!pmu_fw_event_code_valid(fw_id) ||
+		     fw_id == SBI_PMU_FW_PLATFORM))
 		return SBI_EINVAL;
 
-	for (cidx = num_hw_ctrs; cidx < total_ctrs; cidx++) {
-		if (get_cidx_code(phs->active_events[cidx]) == fw_id &&
-		    (phs->fw_counters_started & BIT(cidx - num_hw_ctrs))) {
-			fcounter = &phs->fw_counters_data[cidx - num_hw_ctrs];
-			break;
-		}
+	fw_idx = phs->fw_event_ctr[pmu_fw_event_slot(fw_id)];
+	if (!fw_idx)
+		return 0;
+
+	phs->fw_counters_data[fw_idx - 1] += val;
+
+	return 0;
+}
+
+int sbi_pmu_snapshot_set_shmem(unsigned long shmem_lo,
+			       unsigned long shmem_hi, unsigned long flags)
+{
+	struct sbi_pmu_hart_state *phs = pmu_thishart_state_ptr();
+
+	if (unlikely(!phs))
+		return SBI_EINVAL;
+
+	if (flags)
+		return SBI_EINVAL;
+
+	if (shmem_lo == -1UL && shmem_hi == -1UL) {
+		phs->snapshot_addr = PMU_SNAPSHOT_NONE;
+		return 0;
 	}
 
-	if (fcounter)
-		(*fcounter)++;
+	if (shmem_lo & (SBI_PMU_SNAPSHOT_SIZE - 1))
+		return SBI_EINVAL;
+
+	/* M-mode only accesses the first 4GB on RV32, see event_get_info */
+	if (shmem_hi)
+		return SBI_EINVALID_ADDR;
+
+	if (!sbi_domain_check_addr_range(sbi_domain_thishart_ptr(),
+					 shmem_lo, SBI_PMU_SNAPSHOT_SIZE, PRV_S,
+					 SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return SBI_EINVALID_ADDR;
+
+	if (sbi_hart_map_saddr(shmem_lo, SBI_PMU_SNAPSHOT_SIZE))
+		return SBI_EFAIL;
+	sbi_memset((void *)shmem_lo, 0, SBI_PMU_SNAPSHOT_SIZE);
+	sbi_hart_unmap_saddr();
+
+	phs->snapshot_addr = shmem_lo;
 
 	return 0;
 }
@@ -1052,6 +1245,8 @@ static void pmu_reset_event_map(struct sbi_pmu_hart_state *phs)
 	for (j = 0; j < SBI_PMU_FW_CTR_MAX; j++)
 		phs->fw_counters_data[j] = 0;
 	phs->fw_counters_started = 0;
+	pmu_fw_event_map_update(phs);
+	phs->snapshot_addr = PMU_SNAPSHOT_NONE;
 	phs->sse_enabled = 0;
 }
 
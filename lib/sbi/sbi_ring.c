@@ -0,0 +1,98 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+
+#include <sbi/riscv_barrier.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_ring.h>
+#include <sbi/sbi_string.h>
+
+int sbi_ring_init(struct sbi_ring *ring, void *queue_mem, u32 entries,
+		  u32 entry_size)
+{
+	if (!ring || !queue_mem || !entries || !entry_size ||
+	    (entries & (entries - 1)))
+		return SBI_EINVAL;
+
+	ring->queue	  = queue_mem;
+	ring->num_entries = entries;
+	ring->entry_size  = entry_size;
+	ring->head = ring->tail = 0;
+	sbi_memset(ring->queue, 0, (size_t)entries * entry_size);
+
+	return 0;
+}
+
+static inline void *sbi_ring_slot(struct sbi_ring *ring, u32 index)
+{
+	index &= ring->num_entries - 1;
+	return (char *)ring->queue + (size_t)index * ring->entry_size;
+}
+
+u32 sbi_ring_avail(struct sbi_ring *ring)
+{
+	if (!ring)
+		return 0;
+
+	return __smp_load_acquire(&ring->tail) - ring->head;
+}
+
+bool sbi_ring_is_empty(struct sbi_ring *ring)
+{
+	return sbi_ring_avail(ring) == 0;
+}
+
+bool sbi_ring_is_full(struct sbi_ring *ring)
+{
+	if (!ring)
+		return false;
+
+	return (ring->tail - __smp_load_acquire(&ring->head)) ==
+		ring->num_entries;
+}
+
+/* Note: must only be called by the producer of the ring */
+int sbi_ring_enqueue(struct sbi_ring *ring, void *data)
+{
+	u32 tail;
+
+	if (!ring || !data)
+		return SBI_EINVAL;
+
+	/*
+	 * The acquire on head pairs with the release in dequeue so
+	 * the consumer is done reading a slot before it is reused.
+	 */
+	tail = ring->tail;
+	if (tail - __smp_load_acquire(&ring->head) == ring->num_entries)
+		return SBI_ENOSPC;
+
+	sbi_memcpy(sbi_ring_slot(ring, tail), data, ring->entry_size);
+
+	/* Publish the slot contents before the new tail */
+	__smp_store_release(&ring->tail, tail + 1);
+
+	return 0;
+}
+
+/* Note: must only be called by the consumer of the ring */
+int sbi_ring_dequeue(struct sbi_ring *ring, void *data)
+{
+	u32 head;
+
+	if (!ring || !data)
+		return SBI_EINVAL;
+
+	head = ring->head;
+	if (head == __smp_load_acquire(&ring->tail))
+		return SBI_ENOENT;
+
+	sbi_memcpy(data, sbi_ring_slot(ring, head), ring->entry_size);
+
+	/* Hand the slot back to the producer only after it is copied */
+	__smp_store_release(&ring->head, head + 1);
+
+	return 0;
+}
@@ -21,13 +21,55 @@ struct sbi_scratch *hartindex_to_scratch_table[SBI_HARTMASK_MAX_BITS + 1] = { 0
 static spinlock_t extra_lock = SPIN_LOCK_INITIALIZER;
 static unsigned long extra_offset = SBI_SCRATCH_EXTRA_SPACE_OFFSET;
 
-u32 sbi_hartid_to_hartindex(u32 hartid)
+/* clang-format off */
+
+/* Open addressing HART id hash, at most half full */
+#define HARTID_HASH_SIZE	(2 * SBI_HARTMASK_MAX_BITS)
+#define HARTID_HASH_BITS	__builtin_ctz(HARTID_HASH_SIZE)
+#define HARTID_HASH_MASK	(HARTID_HASH_SIZE - 1)
+
+/* clang-format on */
+
+/* HART index + 1 of each slot, zero for an empty slot */
+static u16 hartid_hash_table[HARTID_HASH_SIZE];
+
+/*
+ * HART ids below the table size map to themselves so dense layouts
+ * never collide while higher bits (e.g. cluster ids of sparse layouts)
+ * are folded in for all other HART ids.
+ */
+static inline u32 hartid_hash(u32 hartid)
 {
-	u32 i;
+	return (hartid ^ (hartid >> HARTID_HASH_BITS) ^
+		(hartid >> (2 * HARTID_HASH_BITS))) & HARTID_HASH_MASK;
+}
 
-	for (i = 0; i <= last_hartindex_having_scratch; i++)
-		if (hartindex_to_hartid_table[i] == hartid)
-			return i;
+void sbi_scratch_hartid_lookup_init(void)
+{
+	u32 i, slot;
+
+	sbi_memset(hartid_hash_table, 0, sizeof(hartid_hash_table));
+
+	for (i = 0; i <= last_hartindex_having_scratch; i++) {
+		/* Linear probing always finds a slot in a half full table */
+		slot = hartid_hash(hartindex_to_hartid_table[i]);
+		while (hartid_hash_table[slot])
+			slot = (slot + 1) & HARTID_HASH_MASK;
+		hartid_hash_table[slot] = i + 1;
+	}
+}
+
+u32 sbi_hartid_to_hartindex(u32 hartid)
+{
+	u32 slot = hartid_hash(hartid);
+	u32 hartindex;
+
+	while (hartid_hash_table[slot]) {
+		hartindex = hartid_hash_table[slot] - 1;
+		if (hartindex_to_hartid_table[hartindex] == hartid)
+			return hartindex;
+		slot = (slot + 1) & HARTID_HASH_MASK;
+	}
 
 	return -1U;
 }
@@ -47,6 +89,7 @@ int sbi_scratch_init(struct sbi_scratch *scratch)
 	}
 
 	last_hartindex_having_scratch = plat->hart_count - 1;
+	sbi_scratch_hartid_lookup_init();
 
 	return 0;
 }
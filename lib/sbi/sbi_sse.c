@@ -9,6 +9,7 @@
 #include <sbi/riscv_barrier.h>
 #include <sbi/riscv_encoding.h>
 #include <sbi/riscv_locks.h>
+#include <sbi/sbi_bitops.h>
 #include <sbi/sbi_domain.h>
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
@@ -46,10 +47,32 @@ static const uint32_t supported_events[] = {
 	SBI_SSE_EVENT_LOCAL_PMU,
 	SBI_SSE_EVENT_LOCAL_SOFTWARE,
 	SBI_SSE_EVENT_GLOBAL_SOFTWARE,
+#ifdef CONFIG_SBI_FWFT_MISALIGNED_AUTO
+	SBI_SSE_EVENT_LOCAL_MISALIGNED_RATE,
+#endif
 };
 
 #define EVENT_COUNT array_size(supported_events)
 
+/* Enabled events of a hart are tracked by rank in a single word */
+_Static_assert(EVENT_COUNT <= BITS_PER_LONG,
+	       "too many SSE events for the per-hart event bitmaps");
+
+/*
+ * Event ids are mapped to a slot, the index of the event in global_events
+ * or in the per-hart local_events. Standard events have small ids in each
+ * of the four id groups (0x0000xxxx, 0x0001xxxx, 0x0002xxxx and
+ * 0xffffxxxx) and go in a direct table, other ids in a small open
+ * addressing hash. Entries hold the slot plus one so that zero is empty.
+ */
+#define SSE_DIRECT_GROUPS	4
+#define SSE_DIRECT_IDS		8
+#define SSE_HASH_BITS		4
+#define SSE_HASH_SIZE		(1U << SSE_HASH_BITS)
+
+_Static_assert(EVENT_COUNT < SSE_HASH_SIZE / 2 && EVENT_COUNT < 0xff,
+	       "SSE event index too small for the supported events");
+
 #define sse_event_invoke_cb(_event, _cb, ...)                                 \
 	{                                                                     \
 		if (_event->cb_ops && _event->cb_ops->_cb)                    \
@@ -76,6 +99,12 @@ struct sse_interrupted_state {
 
 struct sse_ipi_inject_data {
 	uint32_t event_id;
+	u32 slot;
+};
+
+struct sse_event_index_entry {
+	uint32_t event_id;
+	u8 slot;
 };
 
 struct sbi_sse_event_attrs {
@@ -110,6 +139,8 @@ struct sbi_sse_event {
 	struct sbi_sse_event_attrs attrs;
 	uint32_t event_id;
 	u32 hartindex;
+	/** Position in the owner hart enabled_event_list, valid if enabled */
+	u32 rank;
 	const struct sbi_sse_cb_ops *cb_ops;
 	struct sbi_dlist node;
 };
@@ -139,6 +170,24 @@ struct sse_hart_state {
 	 */
 	spinlock_t enabled_event_lock;
 
+	/**
+	 * Events of enabled_event_list indexed by their rank in the list,
+	 * so bit 0 of the bitmaps below is the highest priority event.
+	 */
+	struct sbi_sse_event *ranked[EVENT_COUNT];
+
+	/**
+	 * Bitmap of enabled events with a pending injection. Updated under
+	 * enabled_event_lock but read without it on trap return, which is
+	 * fine since other harts only set bits ahead of an IPI to this hart.
+	 */
+	unsigned long pending;
+
+	/**
+	 * Bitmap of events in RUNNING state, protected by enabled_event_lock.
+	 */
+	unsigned long running;
+
 	/**
 	 * List of local events allocated at boot time.
 	 */
@@ -171,6 +220,9 @@ static unsigned int local_event_count;
 static unsigned int global_event_count;
 static struct sse_global_event *global_events;
 
+static u8 sse_direct_index[SSE_DIRECT_GROUPS * 2 * SSE_DIRECT_IDS];
+static struct sse_event_index_entry sse_hash_index[SSE_HASH_SIZE];
+
 static unsigned long sse_inject_fifo_off;
 static unsigned long sse_inject_fifo_mem_off;
 /* Offset of pointer to SSE HART state in scratch space */
@@ -244,30 +296,90 @@ static void sse_event_set_state(struct sbi_sse_event *e,
 	e->attrs.status |= new_state;
 }
 
-static struct sbi_sse_event *sse_event_get(uint32_t event_id)
+/* Return the direct table entry of an event id or -1 if it has none */
+static int sse_direct_index_pos(uint32_t event_id)
+{
+	u32 group = event_id >> 16;
+	u32 id = event_id & (SBI_SSE_EVENT_GLOBAL_BIT - 1);
+
+	if (group == 0xffff)
+		group = SSE_DIRECT_GROUPS - 1;
+	else if (group >= SSE_DIRECT_GROUPS - 1)
+		return -1;
+
+	/* Platform ids have SBI_SSE_EVENT_PLATFORM_BIT set and end up here */
+	if (id >= SSE_DIRECT_IDS)
+		return -1;
+
+	return (group * 2 + !!EVENT_IS_GLOBAL(event_id)) * SSE_DIRECT_IDS + id;
+}
+
+static u32 sse_hash_index_pos(uint32_t event_id)
+{
+	return (event_id * 0x9e3779b1U) >> (32 - SSE_HASH_BITS);
+}
+
+/**
+ * Must only be called at cold boot, the index is read locklessly
+ */
+static void sse_event_index_add(uint32_t event_id, u32 slot)
+{
+	int pos = sse_direct_index_pos(event_id);
+	u32 h;
+
+	if (pos >= 0) {
+		sse_direct_index[pos] = slot + 1;
+		return;
+	}
+
+	h = sse_hash_index_pos(event_id);
+	while (sse_hash_index[h].slot)
+		h = (h + 1) & (SSE_HASH_SIZE - 1);
+
+	sse_hash_index[h].event_id = event_id;
+	sse_hash_index[h].slot = slot + 1;
+}
+
+/* Return the slot of an event id or -1 if the event is not supported */
+static int sse_event_slot(uint32_t event_id)
+{
+	int pos = sse_direct_index_pos(event_id);
+	u32 h;
+
+	if (pos >= 0)
+		return (int)sse_direct_index[pos] - 1;
+
+	h = sse_hash_index_pos(event_id);
+	while (sse_hash_index[h].slot) {
+		if (sse_hash_index[h].event_id == event_id)
+			return sse_hash_index[h].slot - 1;
+		h = (h + 1) & (SSE_HASH_SIZE - 1);
+	}
+
+	return -1;
+}
+
+static struct sbi_sse_event *sse_event_get_slot(uint32_t event_id, u32 slot)
 {
-	unsigned int i;
-	struct sbi_sse_event *e;
 	struct sse_hart_state *shs;
 
 	if (EVENT_IS_GLOBAL(event_id)) {
-		for (i = 0; i < global_event_count; i++) {
-			e = &global_events[i].event;
-			if (e->event_id == event_id) {
-				spin_lock(&global_events[i].lock);
-				return e;
-			}
-		}
-	} else {
-		shs = sse_thishart_state_ptr();
-		for (i = 0; i < local_event_count; i++) {
-			e = &shs->local_events[i];
-			if (e->event_id == event_id)
-				return e;
-		}
+		spin_lock(&global_events[slot].lock);
+		return &global_events[slot].event;
 	}
 
-	return NULL;
+	shs = sse_thishart_state_ptr();
+	return &shs->local_events[slot];
+}
+
+static struct sbi_sse_event *sse_event_get(uint32_t event_id)
+{
+	int slot = sse_event_slot(event_id);
+
+	if (slot < 0)
+		return NULL;
+
+	return sse_event_get_slot(event_id, slot);
 }
 
 static void sse_event_put(struct sbi_sse_event *e)
@@ -281,9 +393,52 @@ static void sse_event_put(struct sbi_sse_event *e)
 	spin_unlock(&ge->lock);
 }
 
+/**
+ * Sync the pending and running bits of an enabled event.
+ * Must be called under owner hart lock
+ */
+static void sse_event_update_bits(struct sbi_sse_event *e)
+{
+	struct sse_hart_state *state = sse_get_hart_state(e);
+	unsigned long bit = BIT(e->rank);
+
+	if (sse_event_pending(e))
+		state->pending |= bit;
+	else
+		state->pending &= ~bit;
+
+	if (sse_event_state(e) == SBI_SSE_STATE_RUNNING)
+		state->running |= bit;
+	else
+		state->running &= ~bit;
+}
+
+/**
+ * Renumber the enabled events after the list changed.
+ * Must be called under owner hart lock
+ */
+static void sse_hart_state_rank(struct sse_hart_state *state)
+{
+	struct sbi_sse_event *tmp;
+	u32 rank = 0;
+
+	state->pending = 0;
+	state->running = 0;
+
+	sbi_list_for_each_entry(tmp, &state->enabled_event_list, node) {
+		tmp->rank = rank;
+		state->ranked[rank++] = tmp;
+		sse_event_update_bits(tmp);
+	}
+}
+
+/**
+ * Must be called under owner hart lock
+ */
 static void sse_event_remove_from_list(struct sbi_sse_event *e)
 {
 	sbi_list_del(&e->node);
+	sse_hart_state_rank(sse_get_hart_state(e));
 }
 
 /**
@@ -302,6 +457,7 @@ static void sse_event_add_to_list(struct sbi_sse_event *e)
 			break;
 	}
 	sbi_list_add_tail(&e->node, &tmp->node);
+	sse_hart_state_rank(state);
 }
 
 /**
@@ -475,7 +631,8 @@ static void sse_event_inject(struct sbi_sse_event *e,
 
 	sse_event_set_state(e, SBI_SSE_STATE_RUNNING);
 
-	e->attrs.status = ~BIT(SBI_SSE_ATTR_STATUS_PENDING_OFFSET);
+	e->attrs.status &= ~BIT(SBI_SSE_ATTR_STATUS_PENDING_OFFSET);
+	sse_event_update_bits(e);
 
 	i_ctx->a6 = regs->a6;
 	i_ctx->a7 = regs->a7;
@@ -593,7 +750,7 @@ static bool sse_event_check_inject(struct sbi_sse_event *e,
 				   struct sbi_trap_regs *regs)
 {
 	/*
-	 * List of event is ordered by priority, stop at first running
+	 * Events are visited by priority, stop at first running
 	 * event since all other events after this one are of lower
 	 * priority. This means an event of higher priority is already
 	 * running.
@@ -610,26 +767,27 @@ static bool sse_event_check_inject(struct sbi_sse_event *e,
 	return false;
 }
 
-/* Return true if an event has been injected, false otherwise */
 void sbi_sse_process_pending_events(struct sbi_trap_regs *regs)
 {
-	bool ret;
-	struct sbi_sse_event *e;
+	unsigned long candidates;
 	struct sse_hart_state *state = sse_thishart_state_ptr();
+	int rank;
 
-	/* if sse is masked on this hart, do nothing */
-	if (state->masked)
+	/* if sse is masked or nothing is pending on this hart, do nothing */
+	if (state->masked || !state->pending)
 		return;
 
 	spin_lock(&state->enabled_event_lock);
 
-	sbi_list_for_each_entry(e, &state->enabled_event_list, node) {
-		ret = sse_event_check_inject(e, regs);
-		if (ret)
-			goto out;
+	/* Lowest rank first, i.e. highest priority first */
+	candidates = state->pending | state->running;
+	while (candidates) {
+		rank = sbi_ffs(candidates);
+		if (sse_event_check_inject(state->ranked[rank], regs))
+			break;
+		candidates &= ~BIT(rank);
 	}
 
-out:
 	spin_unlock(&state->enabled_event_lock);
 }
 
@@ -639,7 +797,10 @@ static int sse_event_set_pending(struct sbi_sse_event *e)
 	    sse_event_state(e) != SBI_SSE_STATE_ENABLED)
 		return SBI_EINVALID_STATE;
 
+	sse_enabled_event_lock(e);
 	e->attrs.status |= BIT(SBI_SSE_ATTR_STATUS_PENDING_OFFSET);
+	sse_event_update_bits(e);
+	sse_enabled_event_unlock(e);
 
 	return SBI_OK;
 }
@@ -653,10 +814,7 @@ static void sse_ipi_inject_process(struct sbi_scratch *scratch)
 
 	/* Mark all queued events as pending */
 	while (!sbi_fifo_dequeue(sse_inject_fifo_r, &evt)) {
-		e = sse_event_get(evt.event_id);
-		if (!e)
-			continue;
-
+		e = sse_event_get_slot(evt.event_id, evt.slot);
 		sse_event_set_pending(e);
 		sse_event_put(e);
 	}
@@ -674,6 +832,12 @@ static int sse_ipi_inject_send(unsigned long hartid, uint32_t event_id)
 	struct sse_ipi_inject_data evt = {event_id};
 	struct sbi_fifo *sse_inject_fifo_r;
 
+	/* Resolve the slot once here so the target hart skips the lookup */
+	ret = sse_event_slot(event_id);
+	if (ret < 0)
+		return SBI_EINVAL;
+	evt.slot = ret;
+
 	remote_scratch = sbi_hartid_to_scratch(hartid);
 	if (!remote_scratch)
 		return SBI_EINVAL;
@@ -750,6 +914,7 @@ static int sse_event_complete(struct sbi_sse_event *e,
 		return SBI_EINVAL;
 
 	sse_event_set_state(e, SBI_SSE_STATE_ENABLED);
+	sse_event_update_bits(e);
 	if (e->attrs.config & SBI_SSE_ATTR_CONFIG_ONESHOT)
 		sse_event_disable(e);
 
@@ -764,20 +929,16 @@ static int sse_event_complete(struct sbi_sse_event *e,
 int sbi_sse_complete(struct sbi_trap_regs *regs, struct sbi_ecall_return *out)
 {
 	int ret = SBI_OK;
-	struct sbi_sse_event *tmp;
 	struct sse_hart_state *state = sse_thishart_state_ptr();
 
 	spin_lock(&state->enabled_event_lock);
-	sbi_list_for_each_entry(tmp, &state->enabled_event_list, node) {
-		/*
-		 * List of event is ordered by priority, first one running is
-		 * the one that needs to be completed
-		 */
-		if (sse_event_state(tmp) == SBI_SSE_STATE_RUNNING) {
-			ret = sse_event_complete(tmp, regs, out);
-			break;
-		}
-	}
+	/*
+	 * Events are ranked by priority, first one running is the one that
+	 * needs to be completed
+	 */
+	if (state->running)
+		ret = sse_event_complete(state->ranked[sbi_ffs(state->running)],
+					 regs, out);
 	spin_unlock(&state->enabled_event_lock);
 
 	return ret;
@@ -1082,16 +1243,20 @@ static void sse_event_count_init()
 static int sse_global_init()
 {
 	struct sbi_sse_event *e;
-	unsigned int i, ev = 0;
+	unsigned int i, ev = 0, lev = 0;
 
 	global_events = sbi_zalloc(sizeof(*global_events) * global_event_count);
 	if (!global_events)
 		return SBI_ENOMEM;
 
 	for (i = 0; i < EVENT_COUNT; i++) {
-		if (!EVENT_IS_GLOBAL(supported_events[i]))
+		/* Local events get the same slot on all harts */
+		if (!EVENT_IS_GLOBAL(supported_events[i])) {
+			sse_event_index_add(supported_events[i], lev++);
 			continue;
+		}
 
+		sse_event_index_add(supported_events[i], ev);
 		e = &global_events[ev].event;
 		sse_event_init(e, supported_events[i]);
 		SPIN_LOCK_INIT(global_events[ev].lock);
@@ -1104,7 +1269,7 @@ static int sse_global_init()
 
 static void sse_local_init(struct sse_hart_state *shs)
 {
-	unsigned int i, ev = 0;
+	unsigned int i;
 
 	SBI_INIT_LIST_HEAD(&shs->enabled_event_list);
 	SPIN_LOCK_INIT(shs->enabled_event_lock);
@@ -1113,7 +1278,9 @@ static void sse_local_init(struct sse_hart_state *shs)
 		if (EVENT_IS_GLOBAL(supported_events[i]))
 			continue;
 
-		sse_event_init(&shs->local_events[ev++], supported_events[i]);
+		sse_event_init(&shs->local_events[sse_event_slot(
+					supported_events[i])],
+			       supported_events[i]);
 	}
 }
 
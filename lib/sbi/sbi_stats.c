@@ -0,0 +1,199 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+
+#include <sbi/sbi_bitops.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_heap.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_stats.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_timer.h>
+
+struct stats_hart {
+	struct sbi_opensbi_stats_header hdr;
+	/* Set by a snapshot from another HART, applied by the owner */
+	bool reset;
+	/* Open addressing hash table keyed by kind, id and fid */
+	struct sbi_opensbi_stats_entry entries[CONFIG_SBI_STATS_ENTRIES];
+};
+
+_Static_assert(sizeof(struct stats_hart) <= SBI_STATS_HART_SIZE,
+	       "SBI_STATS_HART_SIZE is too small");
+
+static unsigned long stats_hart_offset;
+
+static inline struct stats_hart *stats_hart_ptr(struct sbi_scratch *scratch)
+{
+	if (!stats_hart_offset)
+		return NULL;
+
+	return sbi_scratch_read_type(scratch, struct stats_hart *,
+				     stats_hart_offset);
+}
+
+/*
+ * Always the time CSR: mcycle stops counting once S-mode stops PMU
+ * counter 0 through mcountinhibit, which Linux does at CPU bring-up.
+ */
+static inline unsigned long stats_clock(void)
+{
+	return sbi_timer_value();
+}
+
+static u32 stats_bucket(unsigned long delta)
+{
+	u32 ret;
+
+	if (delta < (1UL << SBI_OPENSBI_STATS_BUCKET_SHIFT))
+		return 0;
+
+	ret = sbi_fls(delta) - SBI_OPENSBI_STATS_BUCKET_SHIFT + 1;
+	return MIN(ret, SBI_OPENSBI_STATS_BUCKETS - 1);
+}
+
+static void stats_clear(struct stats_hart *sh)
+{
+	sbi_memset(sh->entries, 0, sizeof(sh->entries));
+	sh->hdr.num_entries = 0;
+	sh->hdr.dropped = 0;
+}
+
+static struct sbi_opensbi_stats_entry *stats_find(struct stats_hart *sh,
+						  u32 kind, unsigned long id,
+						  u32 fid)
+{
+	struct sbi_opensbi_stats_entry *e;
+	u32 i, pos;
+
+	pos = ((u32)id * 0x9e3779b1U ^ fid * 0x85ebca6bU ^ kind) %
+	      CONFIG_SBI_STATS_ENTRIES;
+	for (i = 0; i < CONFIG_SBI_STATS_ENTRIES; i++) {
+		e = &sh->entries[pos];
+		if (!e->kind) {
+			e->kind = kind;
+			e->id = id;
+			e->fid = fid;
+			sh->hdr.num_entries++;
+			return e;
+		}
+		if (e->kind == kind && e->id == id && e->fid == fid)
+			return e;
+		if (++pos == CONFIG_SBI_STATS_ENTRIES)
+			pos = 0;
+	}
+
+	return NULL;
+}
+
+static void stats_record(u32 kind, unsigned long id, u32 fid,
+			 unsigned long start)
+{
+	struct stats_hart *sh = stats_hart_ptr(sbi_scratch_thishart_ptr());
+	struct sbi_opensbi_stats_entry *e;
+	unsigned long delta;
+
+	if (!sh)
+		return;
+
+	delta = stats_clock() - start;
+
+	if (sh->reset) {
+		stats_clear(sh);
+		sh->reset = false;
+	}
+
+	e = stats_find(sh, kind, id, fid);
+	if (!e) {
+		sh->hdr.dropped++;
+		return;
+	}
+
+	e->total += delta;
+	e->buckets[stats_bucket(delta)]++;
+}
+
+unsigned long sbi_stats_timestamp(void)
+{
+	struct stats_hart *sh = stats_hart_ptr(sbi_scratch_thishart_ptr());
+
+	return sh ? stats_clock() : 0;
+}
+
+void sbi_stats_record_trap(unsigned long mcause, unsigned long start)
+{
+	stats_record(SBI_OPENSBI_STATS_KIND_TRAP, mcause, 0, start);
+}
+
+void sbi_stats_record_ecall(unsigned long extid, unsigned long fid,
+			    unsigned long start)
+{
+	stats_record(SBI_OPENSBI_STATS_KIND_ECALL, extid, fid, start);
+}
+
+int sbi_stats_snapshot(u32 hartindex, void *buf, unsigned long size,
+		       bool reset, unsigned long *out_entries)
+{
+	struct sbi_opensbi_stats_header *hdr = buf;
+	struct sbi_opensbi_stats_entry *out = (void *)(hdr + 1);
+	struct sbi_scratch *scratch = sbi_hartindex_to_scratch(hartindex);
+	struct stats_hart *sh = scratch ? stats_hart_ptr(scratch) : NULL;
+	unsigned long max;
+	u32 i, count = 0;
+
+	if (!sh)
+		return SBI_EINVAL;
+	if (size < sizeof(*hdr))
+		return SBI_EINVAL;
+
+	/*
+	 * Histograms of other HARTs are copied while they are updated so
+	 * a snapshot may be off by the records done in the meantime.
+	 */
+	max = (size - sizeof(*hdr)) / sizeof(*out);
+	for (i = 0; i < CONFIG_SBI_STATS_ENTRIES && count < max; i++) {
+		if (!sh->entries[i].kind)
+			continue;
+		sbi_memcpy(&out[count++], &sh->entries[i], sizeof(*out));
+	}
+
+	sbi_memcpy(hdr, &sh->hdr, sizeof(*hdr));
+	hdr->num_entries = count;
+	hdr->num_buckets = SBI_OPENSBI_STATS_BUCKETS;
+	*out_entries = sh->hdr.num_entries;
+
+	if (reset) {
+		if (scratch == sbi_scratch_thishart_ptr())
+			stats_clear(sh);
+		else
+			sh->reset = true;
+	}
+
+	return 0;
+}
+
+int sbi_stats_init(struct sbi_scratch *scratch, bool cold_boot)
+{
+	struct stats_hart *sh;
+
+	if (cold_boot) {
+		stats_hart_offset = sbi_scratch_alloc_type_offset(struct stats_hart *);
+		if (!stats_hart_offset)
+			return SBI_ENOMEM;
+	}
+
+	sh = stats_hart_ptr(scratch);
+	if (!sh) {
+		sh = sbi_zalloc(sizeof(*sh));
+		if (!sh)
+			return SBI_ENOMEM;
+		sbi_scratch_write_type(scratch, struct stats_hart *,
+				       stats_hart_offset, sh);
+	}
+
+	sh->hdr.clock = SBI_OPENSBI_STATS_CLOCK_TIME;
+
+	return 0;
+}
@@ -8,12 +8,74 @@
  */
 
 /*
- * Simple libc functions. These are not optimized at all and might have some
- * bugs as well. Use any optimized routines from newlib or glibc if required.
+ * Simple libc functions. Only the memory block functions and sbi_strlen()
+ * are optimized since these sit on the hot paths of the firmware. The
+ * rest are not optimized at all and might have some bugs as well. Use
+ * any optimized routines from newlib or glibc if required.
  */
 
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_scratch.h>
 #include <sbi/sbi_string.h>
 
+/*
+ * The word-at-a-time helpers below only ever do naturally aligned word
+ * accesses so they also work with -mstrict-align. Reading a whole
+ * aligned word around the terminating NUL of a string never crosses a
+ * page boundary. Words are assumed to be little-endian.
+ */
+#define STR_WSIZE		sizeof(unsigned long)
+#define STR_WMASK		(STR_WSIZE - 1)
+#define STR_ONES		((unsigned long)-1 / 0xff)
+#define STR_HIGHS		(STR_ONES << 7)
+
+/* Below this length the byte loops win over the alignment prologue */
+#define STR_SMALL		(4 * STR_WSIZE)
+
+/* Vector copies need to save the vector registers so only use them for big blocks */
+#define STR_VEC_MIN		1024
+
+/*
+ * Set up by sbi_hart_init(). This file must not depend on anything else
+ * in libsbi because test payloads link it and run it in S-mode, where
+ * the offset stays zero.
+ */
+unsigned long sbi_string_hart_offset;
+
+static inline unsigned long string_hart_flags(void)
+{
+	struct sbi_string_hart *sh;
+
+	/* Nothing is accelerated before the HART features are known */
+	if (!sbi_string_hart_offset)
+		return 0;
+
+	sh = sbi_scratch_thishart_offset_ptr(sbi_string_hart_offset);
+	return sh->flags;
+}
+
+static inline bool str_aligned(const void *p)
+{
+	return !((unsigned long)p & STR_WMASK);
+}
+
+/* Non-zero if any byte of w is zero */
+static inline unsigned long str_haszero(unsigned long w)
+{
+	return (w - STR_ONES) & ~w & STR_HIGHS;
+}
+
+/* Zbb orc.b: every non-zero byte becomes 0xff and every zero byte stays 0 */
+static inline unsigned long str_orc_b(unsigned long w)
+{
+	unsigned long ret;
+
+	asm volatile(".insn i 0x13, 0x5, %0, %1, 0x287"
+		     : "=r"(ret) : "r"(w));
+	return ret;
+}
+
 /*
   Provides sbi_strcmp for the completeness of supporting string functions.
   it is not recommended to use sbi_strcmp() but use sbi_strncmp instead.
@@ -42,16 +104,31 @@ int sbi_strncmp(const char *a, const char *b, size_t count)
 
 size_t sbi_strlen(const char *str)
 {
-	unsigned long ret = 0;
+	const unsigned long *w;
+	const char *s = str;
 
-	while (*str != '\0') {
-		ret++;
-		str++;
+	for (; !str_aligned(s); s++) {
+		if (*s == '\0')
+			return s - str;
 	}
 
-	return ret;
-}
+	w = (const unsigned long *)s;
+#ifndef __riscv_zbb
+	if (!(string_hart_flags() & SBI_STRING_HART_ZBB)) {
+		while (!str_haszero(*w))
+			w++;
+	} else
+#endif
+	{
+		while (str_orc_b(*w) == -1UL)
+			w++;
+	}
 
+	for (s = (const char *)w; *s != '\0'; s++)
+		;
+
+	return s - str;
+}
 size_t sbi_strnlen(const char *str, size_t count)
 {
 	unsigned long ret = 0;
@@ -109,52 +186,286 @@ char *sbi_strrchr(const char *s, int c)
 	else
 		return (char *)last;
 }
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+
+struct string_vec_state {
+	unsigned long mstatus;
+	unsigned long vstart;
+	unsigned long vl;
+	unsigned long vtype;
+};
+
+/*
+ * M-mode shares the vector registers with the supervisor so save v0-v7
+ * along with vl/vtype/vstart before clobbering them and put everything
+ * back afterwards, including the mstatus.VS state. With mstatus.VS in
+ * the Initial state the registers hold no supervisor data yet, so they
+ * are simply cleared again instead of being saved and reloaded.
+ */
+static void string_vec_begin(struct sbi_string_hart *sh,
+			     struct string_vec_state *st)
+{
+	st->mstatus = csr_read_set(CSR_MSTATUS, MSTATUS_VS);
+	st->vstart = csr_read(CSR_VSTART);
+	st->vl = csr_read(CSR_VL);
+	st->vtype = csr_read(CSR_VTYPE);
+	csr_write(CSR_VSTART, 0);
+
+	if ((st->mstatus & MSTATUS_VS) == MSTATUS_VS_INITIAL)
+		return;
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vs8r.v v0, (%0)\n\t"
+		     ".option pop\n\t"
+		     : : "r"(sh->vsave) : "memory");
+}
+
+static void string_vec_end(struct sbi_string_hart *sh,
+			   struct string_vec_state *st)
+{
+	unsigned long vl;
+
+	if ((st->mstatus & MSTATUS_VS) == MSTATUS_VS_INITIAL)
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvli %0, x0, e8, m8, ta, ma\n\t"
+			     "vmv.v.i v0, 0\n\t"
+			     ".option pop\n\t"
+			     : "=r"(vl));
+	else
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vl8r.v v0, (%0)\n\t"
+			     ".option pop\n\t"
+			     : : "r"(sh->vsave) : "memory");
+
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvl x0, %0, %1\n\t"
+		     ".option pop\n\t"
+		     : : "r"(st->vl), "r"(st->vtype));
+	csr_write(CSR_VSTART, st->vstart);
+	csr_clear(CSR_MSTATUS, MSTATUS_VS & ~st->mstatus);
+}
+
+static struct sbi_string_hart *string_vec_hart(size_t count)
+{
+	if (count < STR_VEC_MIN ||
+	    !(string_hart_flags() & SBI_STRING_HART_VECTOR))
+		return NULL;
+
+	return sbi_scratch_thishart_offset_ptr(sbi_string_hart_offset);
+}
+
+static void string_vec_copy(struct sbi_string_hart *sh, unsigned char *d,
+			    const unsigned char *s, size_t count)
+{
+	struct string_vec_state st;
+	unsigned long vl;
+
+	string_vec_begin(sh, &st);
+	while (count) {
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvli %0, %1, e8, m8, ta, ma\n\t"
+			     "vle8.v v0, (%2)\n\t"
+			     "vse8.v v0, (%3)\n\t"
+			     ".option pop\n\t"
+			     : "=&r"(vl) : "r"(count), "r"(s), "r"(d)
+			     : "memory");
+		d += vl;
+		s += vl;
+		count -= vl;
+	}
+	string_vec_end(sh, &st);
+}
+
+static void string_vec_set(struct sbi_string_hart *sh, unsigned char *d,
+			   int c, size_t count)
+{
+	struct string_vec_state st;
+	unsigned long vl;
+
+	string_vec_begin(sh, &st);
+	asm volatile(".option push\n\t"
+		     ".option arch, +v\n\t"
+		     "vsetvli %0, %1, e8, m8, ta, ma\n\t"
+		     "vmv.v.x v0, %2\n\t"
+		     ".option pop\n\t"
+		     : "=&r"(vl) : "r"(count), "r"(c));
+	while (count) {
+		asm volatile(".option push\n\t"
+			     ".option arch, +v\n\t"
+			     "vsetvli %0, %1, e8, m8, ta, ma\n\t"
+			     "vse8.v v0, (%2)\n\t"
+			     ".option pop\n\t"
+			     : "=&r"(vl) : "r"(count), "r"(d) : "memory");
+		d += vl;
+		count -= vl;
+	}
+	string_vec_end(sh, &st);
+}
+
+#else
+
+static inline struct sbi_string_hart *string_vec_hart(size_t count)
+{
+	return NULL;
+}
+
+static inline void string_vec_copy(struct sbi_string_hart *sh, unsigned char *d,
+				   const unsigned char *s, size_t count)
+{
+}
+
+static inline void string_vec_set(struct sbi_string_hart *sh, unsigned char *d,
+				  int c, size_t count)
+{
+}
+
+#endif
+
 void *sbi_memset(void *s, int c, size_t count)
 {
-	char *temp = s;
+	unsigned char *p = s;
+	struct sbi_string_hart *sh;
+	unsigned long *w, val;
+
+	if (count >= STR_SMALL) {
+		for (; !str_aligned(p); count--)
+			*p++ = c;
+
+		sh = string_vec_hart(count);
+		if (sh) {
+			string_vec_set(sh, p, c, count);
+			return s;
+		}
+
+		val = (unsigned char)c * STR_ONES;
+		w = (unsigned long *)p;
+		for (; count >= 4 * STR_WSIZE; count -= 4 * STR_WSIZE) {
+			w[0] = val;
+			w[1] = val;
+			w[2] = val;
+			w[3] = val;
+			w += 4;
+		}
+		for (; count >= STR_WSIZE; count -= STR_WSIZE)
+			*w++ = val;
+		p = (unsigned char *)w;
+	}
 
 	while (count > 0) {
 		count--;
-		*temp++ = c;
+		*p++ = c;
 	}
 
 	return s;
 }
 
-void *sbi_memcpy(void *dest, const void *src, size_t count)
+/*
+ * Forward copy which is also safe for overlapping blocks as long as
+ * dest is below src. Every source word is loaded before the destination
+ * word covering the same or lower addresses is stored.
+ */
+static void string_copy_fwd(unsigned char *d, const unsigned char *s,
+			    size_t count)
 {
-	char *temp1	  = dest;
-	const char *temp2 = src;
+	const unsigned long *ws;
+	unsigned long *wd, prev, next;
+	unsigned int shift;
+	struct sbi_string_hart *sh;
+
+	if (count >= STR_SMALL) {
+		for (; !str_aligned(d); count--)
+			*d++ = *s++;
+
+		sh = string_vec_hart(count);
+		if (sh) {
+			string_vec_copy(sh, d, s, count);
+			return;
+		}
+
+		wd = (unsigned long *)d;
+		if (str_aligned(s)) {
+			ws = (const unsigned long *)s;
+			for (; count >= 4 * STR_WSIZE; count -= 4 * STR_WSIZE) {
+				prev = ws[0];
+				next = ws[1];
+				wd[0] = prev;
+				wd[1] = next;
+				prev = ws[2];
+				next = ws[3];
+				wd[2] = prev;
+				wd[3] = next;
+				ws += 4;
+				wd += 4;
+			}
+			for (; count >= STR_WSIZE; count -= STR_WSIZE)
+				*wd++ = *ws++;
+			s = (const unsigned char *)ws;
+		} else {
+			/* Merge two aligned source words per destination word */
+			shift = ((unsigned long)s & STR_WMASK) * 8;
+			ws = (const unsigned long *)((unsigned long)s & ~STR_WMASK);
+			prev = *ws++;
+			for (; count >= STR_WSIZE; count -= STR_WSIZE) {
+				next = *ws++;
+				*wd++ = (prev >> shift) |
+					(next << (8 * STR_WSIZE - shift));
+				prev = next;
+			}
+			s = (const unsigned char *)(ws - 1) + shift / 8;
+		}
+		d = (unsigned char *)wd;
+	}
 
 	while (count > 0) {
-		*temp1++ = *temp2++;
+		*d++ = *s++;
 		count--;
 	}
+}
+
+void *sbi_memcpy(void *dest, const void *src, size_t count)
+{
+	string_copy_fwd(dest, src, count);
 
 	return dest;
 }
 
 void *sbi_memmove(void *dest, const void *src, size_t count)
 {
-	char *temp1	  = (char *)dest;
-	const char *temp2 = (char *)src;
+	unsigned char *temp1 = (unsigned char *)dest + count;
+	const unsigned char *temp2 = (const unsigned char *)src + count;
+	unsigned long *wd;
+	const unsigned long *ws;
 
 	if (src == dest)
 		return dest;
 
-	if (dest < src) {
-		while (count > 0) {
-			*temp1++ = *temp2++;
-			count--;
-		}
-	} else {
-		temp1 = (char *)dest + count - 1;
-		temp2 = (char *)src + count - 1;
+	if (dest < src || temp2 <= (unsigned char *)dest) {
+		string_copy_fwd(dest, src, count);
+		return dest;
+	}
 
-		while (count > 0) {
-			*temp1-- = *temp2--;
-			count--;
-		}
+	/* Overlapping with dest above src so copy backwards */
+	if (count >= STR_SMALL &&
+	    !(((unsigned long)temp1 ^ (unsigned long)temp2) & STR_WMASK)) {
+		for (; !str_aligned(temp1); count--)
+			*--temp1 = *--temp2;
+
+		wd = (unsigned long *)temp1;
+		ws = (const unsigned long *)temp2;
+		for (; count >= STR_WSIZE; count -= STR_WSIZE)
+			*--wd = *--ws;
+		temp1 = (unsigned char *)wd;
+		temp2 = (const unsigned char *)ws;
+	}
+
+	while (count > 0) {
+		*--temp1 = *--temp2;
+		count--;
 	}
 
 	return dest;
@@ -162,8 +473,29 @@ void *sbi_memmove(void *dest, const void *src, size_t count)
 
 int sbi_memcmp(const void *s1, const void *s2, size_t count)
 {
-	const char *temp1 = s1;
-	const char *temp2 = s2;
+	const unsigned char *temp1 = s1;
+	const unsigned char *temp2 = s2;
+	const unsigned long *w1, *w2;
+
+	/* Skip the equal words, the byte loop below finds the difference */
+	if (count >= STR_SMALL &&
+	    !(((unsigned long)temp1 ^ (unsigned long)temp2) & STR_WMASK)) {
+		for (; !str_aligned(temp1); count--) {
+			if (*temp1 != *temp2)
+				return *temp1 - *temp2;
+			temp1++;
+			temp2++;
+		}
+
+		w1 = (const unsigned long *)temp1;
+		w2 = (const unsigned long *)temp2;
+		for (; count >= STR_WSIZE && *w1 == *w2; count -= STR_WSIZE) {
+			w1++;
+			w2++;
+		}
+		temp1 = (const unsigned char *)w1;
+		temp2 = (const unsigned char *)w2;
+	}
 
 	for (; count > 0 && (*temp1 == *temp2); count--) {
 		temp1++;
@@ -171,7 +503,7 @@ int sbi_memcmp(const void *s1, const void *s2, size_t count)
 	}
 
 	if (count > 0)
-		return *(unsigned char *)temp1 - *(unsigned char *)temp2;
+		return *temp1 - *temp2;
 	else
 		return 0;
 }
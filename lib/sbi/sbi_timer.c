@@ -18,7 +18,18 @@
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_timer.h>
 
+/** Per-HART timer state */
+struct timer_hart_state {
+	/** Firmware timer events sorted by deadline */
+	struct sbi_dlist events;
+	/** Deadline requested by S-mode without Sstc */
+	u64 s_deadline;
+	/** S-mode deadline is set and has not yet raised STIP */
+	bool s_pending;
+};
+
 static unsigned long time_delta_off;
+static unsigned long timer_hart_off;
 static u64 (*get_time_val)(void);
 static const struct sbi_timer_device *timer_dev = NULL;
 
@@ -130,38 +141,147 @@ void sbi_timer_set_delta_upper(ulong delta_upper)
 }
 #endif
 
+static struct timer_hart_state *timer_thishart(void)
+{
+	if (!timer_hart_off)
+		return NULL;
+
+	return sbi_scratch_offset_ptr(sbi_scratch_thishart_ptr(),
+				      timer_hart_off);
+}
+
+/* Program the timer device with the earliest M-mode or S-mode deadline */
+static void timer_program(struct timer_hart_state *th)
+{
+	struct sbi_timer_event *ev;
+	bool pending = false;
+	u64 next = -1ULL;
+
+	if (!sbi_list_empty(&th->events)) {
+		ev = sbi_list_first_entry(&th->events,
+					  struct sbi_timer_event, head);
+		next = ev->deadline;
+		pending = true;
+	}
+
+	if (th->s_pending) {
+		next = MIN(next, th->s_deadline);
+		pending = true;
+	}
+
+	if (!pending || !timer_dev || !timer_dev->timer_event_start) {
+		csr_clear(CSR_MIE, MIP_MTIP);
+		return;
+	}
+
+	timer_dev->timer_event_start(next);
+	csr_set(CSR_MIE, MIP_MTIP);
+}
+
+int sbi_timer_event_add(struct sbi_timer_event *ev, u64 deadline)
+{
+	struct timer_hart_state *th = timer_thishart();
+	struct sbi_timer_event *pos;
+
+	if (!th)
+		return SBI_EINVALID_STATE;
+	if (!ev || !ev->callback)
+		return SBI_EINVAL;
+
+	if (sbi_timer_event_pending(ev))
+		sbi_list_del_init(&ev->head);
+	ev->deadline = deadline;
+
+	/* Few events are queued at a time, keep them sorted by deadline */
+	sbi_list_for_each_entry(pos, &th->events, head) {
+		if (deadline < pos->deadline)
+			break;
+	}
+	sbi_list_add_tail(&ev->head, &pos->head);
+
+	if (th->events.next == &ev->head)
+		timer_program(th);
+
+	return 0;
+}
+
+void sbi_timer_event_cancel(struct sbi_timer_event *ev)
+{
+	struct timer_hart_state *th = timer_thishart();
+	bool first;
+
+	if (!th || !ev || !sbi_timer_event_pending(ev))
+		return;
+
+	first = th->events.next == &ev->head;
+	sbi_list_del_init(&ev->head);
+	if (first)
+		timer_program(th);
+}
+
 void sbi_timer_event_start(u64 next_event)
 {
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct timer_hart_state *th;
+
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SET_TIMER);
 
 	/**
 	 * Update the stimecmp directly if available. This allows
 	 * the older software to leverage sstc extension on newer hardware.
 	 */
-	if (sbi_hart_has_extension(sbi_scratch_thishart_ptr(), SBI_HART_EXT_SSTC)) {
+	if (sbi_hart_has_extension(scratch, SBI_HART_EXT_SSTC)) {
 #if __riscv_xlen == 32
 		csr_write(CSR_STIMECMP, next_event & 0xFFFFFFFF);
 		csr_write(CSR_STIMECMPH, next_event >> 32);
 #else
 		csr_write(CSR_STIMECMP, next_event);
 #endif
-	} else if (timer_dev && timer_dev->timer_event_start) {
-		timer_dev->timer_event_start(next_event);
-		csr_clear(CSR_MIP, MIP_STIP);
+		return;
 	}
-	csr_set(CSR_MIE, MIP_MTIP);
+
+	/* Same for a vendor supervisor timer, which raises STIP itself */
+	if (sbi_hart_has_extension(scratch, SBI_HART_EXT_XTHEADSSTC) &&
+	    timer_dev && timer_dev->timer_s_event_start) {
+		timer_dev->timer_s_event_start(next_event);
+		return;
+	}
+
+	th = timer_thishart();
+	th->s_deadline = next_event;
+	th->s_pending = true;
+	if (timer_dev && timer_dev->timer_event_start)
+		csr_clear(CSR_MIP, MIP_STIP);
+	timer_program(th);
 }
 
 void sbi_timer_process(void)
 {
-	csr_clear(CSR_MIE, MIP_MTIP);
+	struct timer_hart_state *th = timer_thishart();
+	struct sbi_timer_event *ev;
+	u64 now = sbi_timer_value();
+
+	while (!sbi_list_empty(&th->events)) {
+		ev = sbi_list_first_entry(&th->events,
+					  struct sbi_timer_event, head);
+		if (ev->deadline > now)
+			break;
+
+		sbi_list_del_init(&ev->head);
+		ev->callback(ev);
+	}
+
 	/*
-	 * If sstc extension is available, supervisor can receive the timer
-	 * directly without M-mode come in between. This function should
-	 * only invoked if M-mode programs the timer for its own purpose.
+	 * If sstc or a vendor supervisor timer is available, supervisor
+	 * can receive the timer directly without M-mode come in between
+	 * and s_pending is never set.
 	 */
-	if (!sbi_hart_has_extension(sbi_scratch_thishart_ptr(), SBI_HART_EXT_SSTC))
+	if (th->s_pending && th->s_deadline <= now) {
+		th->s_pending = false;
 		csr_set(CSR_MIP, MIP_STIP);
+	}
+
+	timer_program(th);
 }
 
 const struct sbi_timer_device *sbi_timer_get_device(void)
@@ -183,6 +303,9 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	u64 *time_delta;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
+	struct timer_hart_state *th;
+	struct sbi_scratch *rscratch;
+	u32 i;
 	int ret;
 
 	if (cold_boot) {
@@ -190,6 +313,19 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (!time_delta_off)
 			return SBI_ENOMEM;
 
+		timer_hart_off = sbi_scratch_alloc_offset(sizeof(*th));
+		if (!timer_hart_off)
+			return SBI_ENOMEM;
+
+		/* Events stay queued while a HART is stopped and restarted */
+		for (i = 0; i <= sbi_scratch_last_hartindex(); i++) {
+			rscratch = sbi_hartindex_to_scratch(i);
+			if (!rscratch)
+				continue;
+			th = sbi_scratch_offset_ptr(rscratch, timer_hart_off);
+			SBI_INIT_LIST_HEAD(&th->events);
+		}
+
 		if (sbi_hart_has_extension(scratch, SBI_HART_EXT_ZICNTR))
 			get_time_val = get_ticks;
 
@@ -197,24 +333,35 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 		if (ret)
 			return ret;
 	} else {
-		if (!time_delta_off)
+		if (!time_delta_off || !timer_hart_off)
 			return SBI_ENOMEM;
 	}
 
 	time_delta = sbi_scratch_offset_ptr(scratch, time_delta_off);
 	*time_delta = 0;
 
+	th = sbi_scratch_offset_ptr(scratch, timer_hart_off);
+	th->s_pending = false;
+
 	if (timer_dev && timer_dev->warm_init) {
 		ret = timer_dev->warm_init();
 		if (ret)
 			return ret;
 	}
 
+	if (!sbi_list_empty(&th->events))
+		timer_program(th);
+
 	return 0;
 }
 
 void sbi_timer_exit(struct sbi_scratch *scratch)
 {
+	struct timer_hart_state *th = sbi_scratch_offset_ptr(scratch,
+							     timer_hart_off);
+
+	th->s_pending = false;
+
 	if (timer_dev && timer_dev->timer_event_stop)
 		timer_dev->timer_event_stop();
 
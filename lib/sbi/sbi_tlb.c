@@ -11,8 +11,8 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_atomic.h>
 #include <sbi/riscv_barrier.h>
+#include <sbi/riscv_locks.h>
 #include <sbi/sbi_error.h>
-#include <sbi/sbi_fifo.h>
 #include <sbi/sbi_hart.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_ipi.h>
@@ -23,17 +23,59 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_pmu.h>
+#include <sbi/sbi_ring.h>
 
 static unsigned long tlb_sync_off;
-static unsigned long tlb_fifo_off;
-static unsigned long tlb_fifo_mem_off;
+static unsigned long tlb_queue_off;
+static u32 tlb_ring_entries;
 static unsigned long tlb_range_flush_limit;
+static unsigned long tlb_class_off;
+
+/*
+ * Range flush limits shared by all HARTs with the same mvendorid,
+ * marchid and mimpid. Remote HARTs apply their own limits when they
+ * execute a fence while the sender only upgrades requests larger
+ * than tlb_range_flush_limit, the largest limit of all classes.
+ */
+struct tlb_hart_class {
+	struct tlb_hart_class *next;
+	unsigned long mvendorid;
+	unsigned long marchid;
+	unsigned long mimpid;
+	unsigned long limits[SBI_TLB_FLUSH_LIMIT_MAX];
+};
+
+static struct tlb_hart_class *tlb_hart_classes;
+static spinlock_t tlb_hart_class_lock = SPIN_LOCK_INITIALIZER;
+static u64 tlb_flush_limit_override[SBI_TLB_FLUSH_LIMIT_MAX];
+
+static const char *const tlb_flush_limit_names[SBI_TLB_FLUSH_LIMIT_MAX] = {
+	[SBI_TLB_FLUSH_LIMIT_SFENCE_VMA] = "sfence.vma",
+	[SBI_TLB_FLUSH_LIMIT_HFENCE_GVMA] = "hfence.gvma",
+	[SBI_TLB_FLUSH_LIMIT_HFENCE_VVMA] = "hfence.vvma",
+};
 
 static void tlb_flush_all(void)
 {
 	__asm__ __volatile("sfence.vma");
 }
 
+static bool tlb_local_flush_all(unsigned long start, unsigned long size,
+				enum sbi_tlb_flush_limit_type type)
+{
+	struct tlb_hart_class *class;
+
+	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL))
+		return true;
+
+	class = sbi_scratch_read_type(sbi_scratch_thishart_ptr(), void *,
+				      tlb_class_off);
+	if (class)
+		return size > class->limits[type];
+
+	return size > tlb_range_flush_limit;
+}
+
 static void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 {
 	unsigned long start = tinfo->start;
@@ -46,7 +88,7 @@ static void sbi_tlb_local_hfence_vvma(struct sbi_tlb_info *tinfo)
 	hgatp = csr_swap(CSR_HGATP,
 			 (vmid << HGATP_VMID_SHIFT) & HGATP_VMID_MASK);
 
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_local_flush_all(start, size, SBI_TLB_FLUSH_LIMIT_HFENCE_VVMA)) {
 		__sbi_hfence_vvma_all();
 		goto done;
 	}
@@ -67,7 +109,7 @@ static void sbi_tlb_local_hfence_gvma(struct sbi_tlb_info *tinfo)
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_GVMA_RCVD);
 
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_local_flush_all(start, size, SBI_TLB_FLUSH_LIMIT_HFENCE_GVMA)) {
 		__sbi_hfence_gvma_all();
 		return;
 	}
@@ -85,7 +127,7 @@ static void sbi_tlb_local_sfence_vma(struct sbi_tlb_info *tinfo)
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_RCVD);
 
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_local_flush_all(start, size, SBI_TLB_FLUSH_LIMIT_SFENCE_VMA)) {
 		tlb_flush_all();
 		return;
 	}
@@ -111,7 +153,7 @@ static void sbi_tlb_local_hfence_vvma_asid(struct sbi_tlb_info *tinfo)
 	hgatp = csr_swap(CSR_HGATP,
 			 (vmid << HGATP_VMID_SHIFT) & HGATP_VMID_MASK);
 
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_local_flush_all(start, size, SBI_TLB_FLUSH_LIMIT_HFENCE_VVMA)) {
 		__sbi_hfence_vvma_asid(asid);
 		goto done;
 	}
@@ -133,7 +175,7 @@ static void sbi_tlb_local_hfence_gvma_vmid(struct sbi_tlb_info *tinfo)
 
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_HFENCE_GVMA_VMID_RCVD);
 
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_local_flush_all(start, size, SBI_TLB_FLUSH_LIMIT_HFENCE_GVMA)) {
 		__sbi_hfence_gvma_vmid(vmid);
 		return;
 	}
@@ -153,7 +195,7 @@ static void sbi_tlb_local_sfence_vma_asid(struct sbi_tlb_info *tinfo)
 	sbi_pmu_ctr_incr_fw(SBI_PMU_FW_SFENCE_VMA_ASID_RCVD);
 
 	/* Flush entire MM context for a given ASID */
-	if ((start == 0 && size == 0) || (size == SBI_TLB_FLUSH_ALL)) {
+	if (tlb_local_flush_all(start, size, SBI_TLB_FLUSH_LIMIT_SFENCE_VMA)) {
 		__asm__ __volatile__("sfence.vma x0, %0"
 				     :
 				     : "r"(asid)
@@ -176,6 +218,16 @@ static void sbi_tlb_local_fence_i(struct sbi_tlb_info *tinfo)
 	__asm__ __volatile("fence.i");
 }
 
+static void tlb_range_local_process(const struct sbi_tlb_range *range);
+
+static void sbi_tlb_local_range_batch(struct sbi_tlb_info *tinfo)
+{
+	unsigned long i;
+
+	for (i = 0; i < tinfo->nranges; i++)
+		tlb_range_local_process(&tinfo->ranges[i]);
+}
+
 static void tlb_entry_local_process(struct sbi_tlb_info *data)
 {
 	if (unlikely(!data))
@@ -203,19 +255,310 @@ static void tlb_entry_local_process(struct sbi_tlb_info *data)
 	case SBI_TLB_HFENCE_VVMA:
 		sbi_tlb_local_hfence_vvma(data);
 		break;
+	case SBI_TLB_RANGE_BATCH:
+		sbi_tlb_local_range_batch(data);
+		break;
 	default:
 		break;
 	};
 }
 
-static void tlb_entry_process(struct sbi_tlb_info *tinfo)
+static void tlb_range_local_process(const struct sbi_tlb_range *range)
+{
+	struct sbi_tlb_info rinfo;
+
+	rinfo.start = range->start;
+	rinfo.size = range->size;
+	rinfo.asid = range->asid;
+	rinfo.vmid = range->vmid;
+	rinfo.type = range->type;
+	tlb_entry_local_process(&rinfo);
+}
+
+static inline bool tlb_range_is_flush_all(const struct sbi_tlb_range *range)
+{
+	return (range->start == 0 && range->size == 0) ||
+		range->size == SBI_TLB_FLUSH_ALL;
+}
+
+static inline void tlb_range_set_flush_all(struct sbi_tlb_range *range)
+{
+	range->start = 0;
+	range->size = SBI_TLB_FLUSH_ALL;
+}
+
+/**
+ * Get the widest fence type of a fence family. A fence of the wide type
+ * invalidates the same addresses for every ASID (or VMID) and hence
+ * covers the narrow ASID (or VMID) specific fence of the same family.
+ */
+static enum sbi_tlb_type tlb_type_family(enum sbi_tlb_type type)
+{
+	switch (type) {
+	case SBI_TLB_SFENCE_VMA_ASID:
+		return SBI_TLB_SFENCE_VMA;
+	case SBI_TLB_HFENCE_GVMA_VMID:
+		return SBI_TLB_HFENCE_GVMA;
+	case SBI_TLB_HFENCE_VVMA_ASID:
+		return SBI_TLB_HFENCE_VVMA;
+	default:
+		return type;
+	}
+}
+
+static bool tlb_range_same_family(const struct sbi_tlb_range *a,
+				  const struct sbi_tlb_range *b)
+{
+	enum sbi_tlb_type family = tlb_type_family(a->type);
+
+	if (family != tlb_type_family(b->type))
+		return false;
+
+	/* HFENCE.VVMA always applies to the VMID of one guest */
+	if (family == SBI_TLB_HFENCE_VVMA && a->vmid != b->vmid)
+		return false;
+
+	return true;
+}
+
+static bool tlb_range_same_key(const struct sbi_tlb_range *a,
+			       const struct sbi_tlb_range *b)
+{
+	return a->type == b->type && a->asid == b->asid && a->vmid == b->vmid;
+}
+
+/* Check whether fence a already does everything fence b would do */
+static bool tlb_range_covers(const struct sbi_tlb_range *a,
+			     const struct sbi_tlb_range *b)
+{
+	if (a->type == SBI_TLB_FENCE_I || b->type == SBI_TLB_FENCE_I)
+		return a->type == b->type;
+
+	if (!tlb_range_same_family(a, b))
+		return false;
+
+	if (!tlb_range_same_key(a, b) && a->type != tlb_type_family(a->type))
+		return false;
+
+	if (tlb_range_is_flush_all(a))
+		return true;
+	if (tlb_range_is_flush_all(b))
+		return false;
+
+	return a->start <= b->start &&
+	       b->start + b->size <= a->start + a->size;
+}
+
+/**
+ * Merge the next range into the current range when both describe the
+ * same fence and overlap or touch each other. A flush-all on either side
+ * turns the result into a flush-all, and so does a merged range which
+ * is larger than the range flush limit.
+ */
+static bool tlb_range_coalesce(struct sbi_tlb_range *curr,
+			       const struct sbi_tlb_range *next)
+{
+	unsigned long curr_end, next_end;
+
+	if (!tlb_range_same_key(curr, next))
+		return false;
+
+	if (curr->type == SBI_TLB_FENCE_I)
+		return true;
+
+	if (tlb_range_is_flush_all(curr) || tlb_range_is_flush_all(next)) {
+		tlb_range_set_flush_all(curr);
+		return true;
+	}
+
+	curr_end = curr->start + curr->size;
+	next_end = next->start + next->size;
+	if (next->start > curr_end || curr->start > next_end)
+		return false;
+
+	curr->start = MIN(curr->start, next->start);
+	curr->size = MAX(curr_end, next_end) - curr->start;
+	if (curr->size > tlb_range_flush_limit)
+		tlb_range_set_flush_all(curr);
+
+	return true;
+}
+
+/**
+ * Set of pending fences where no fence covers or touches another fence
+ * with the same key, along with statistics about how it was built.
+ */
+struct tlb_coalescer {
+	struct sbi_tlb_range *ops;
+	u32 nops;
+	u32 max_ops;
+	u32 merged;
+	u32 fence_i_merged;
+	u32 promoted;
+};
+
+static void tlb_coalescer_init(struct tlb_coalescer *c,
+			       struct sbi_tlb_range *ops, u32 max_ops)
+{
+	c->ops = ops;
+	c->nops = 0;
+	c->max_ops = max_ops;
+	c->merged = c->fence_i_merged = c->promoted = 0;
+}
+
+/* Drop pending fences which are covered by the given fence */
+static void tlb_coalescer_drop_covered(struct tlb_coalescer *c,
+				       const struct sbi_tlb_range *r)
+{
+	u32 i = 0;
+
+	while (i < c->nops) {
+		if (tlb_range_covers(r, &c->ops[i])) {
+			c->ops[i] = c->ops[--c->nops];
+			c->merged++;
+		} else {
+			i++;
+		}
+	}
+}
+
+/**
+ * Once more pages are pending for a fence family than the range flush
+ * limit allows, flushing page by page costs more than flushing it all.
+ * Upgrade to a flush-all for the ASID (or VMID) of the last fence when
+ * that key alone passes the limit, otherwise to a flush of the whole
+ * family.
+ */
+static void tlb_coalescer_promote(struct tlb_coalescer *c,
+				  const struct sbi_tlb_range *last)
+{
+	u32 i;
+	struct sbi_tlb_range r;
+	unsigned long key_pages = 0, family_pages = 0;
+
+	if (last->type == SBI_TLB_FENCE_I || tlb_range_is_flush_all(last))
+		return;
+
+	for (i = 0; i < c->nops; i++) {
+		if (!tlb_range_same_family(&c->ops[i], last))
+			continue;
+		if (tlb_range_is_flush_all(&c->ops[i]))
+			continue;
+		family_pages += c->ops[i].size;
+		if (tlb_range_same_key(&c->ops[i], last))
+			key_pages += c->ops[i].size;
+	}
+
+	if (family_pages <= tlb_range_flush_limit)
+		return;
+
+	r = *last;
+	if (key_pages <= tlb_range_flush_limit) {
+		r.type = tlb_type_family(r.type);
+		r.asid = 0;
+		if (r.type != SBI_TLB_HFENCE_VVMA)
+			r.vmid = 0;
+	}
+	tlb_range_set_flush_all(&r);
+
+	tlb_coalescer_drop_covered(c, &r);
+	c->ops[c->nops++] = r;
+	c->promoted++;
+}
+
+/**
+ * Add a fence to the coalescer. Returns false without changing anything
+ * when the fence needs a new slot and the coalescer is already full.
+ */
+static bool tlb_coalescer_add(struct tlb_coalescer *c,
+			      const struct sbi_tlb_range *in)
+{
+	u32 i;
+	struct sbi_tlb_range r = *in;
+
+	if (r.type != SBI_TLB_FENCE_I && r.size > tlb_range_flush_limit)
+		tlb_range_set_flush_all(&r);
+
+again:
+	for (i = 0; i < c->nops; i++) {
+		if (tlb_range_covers(&c->ops[i], &r)) {
+			if (r.type == SBI_TLB_FENCE_I)
+				c->fence_i_merged++;
+			else
+				c->merged++;
+			return true;
+		}
+
+		/* Absorb the pending fence and look again with the result */
+		if (tlb_range_covers(&r, &c->ops[i]) ||
+		    tlb_range_coalesce(&r, &c->ops[i])) {
+			c->ops[i] = c->ops[--c->nops];
+			c->merged++;
+			goto again;
+		}
+	}
+
+	/* Nothing was absorbed if there is still no free slot */
+	if (c->nops == c->max_ops)
+		return false;
+
+	c->ops[c->nops++] = r;
+	tlb_coalescer_promote(c, &r);
+
+	return true;
+}
+
+static void tlb_coalescer_report(struct tlb_coalescer *c)
+{
+	if (c->merged)
+		sbi_pmu_ctr_add_fw(SBI_PMU_FW_TLB_COALESCED, c->merged);
+	if (c->fence_i_merged)
+		sbi_pmu_ctr_add_fw(SBI_PMU_FW_FENCE_I_COALESCED,
+				   c->fence_i_merged);
+	if (c->promoted)
+		sbi_pmu_ctr_add_fw(SBI_PMU_FW_TLB_FLUSH_PROMOTED, c->promoted);
+	c->merged = c->fence_i_merged = c->promoted = 0;
+}
+
+/*
+ * Per-hart TLB request queue
+ *
+ * Every sender hart owns one single-producer ring in the queue of every
+ * receiver hart so enqueueing a request never takes a lock. The sender
+ * marks its ring in the pending mask after publishing an entry and the
+ * receiver only drains the rings of senders found in that mask.
+ */
+struct tlb_queue {
+	/* Senders which may have entries in their ring */
+	struct sbi_hartmask pending;
+	/* Single-producer rings indexed by sender HART index */
+	struct sbi_ring rings[];
+};
+
+/*
+ * The batch lives on the M-mode stack of the receiver so keep it small,
+ * a full batch is simply flushed before fetching more requests.
+ */
+
+/* Maximum number of requests acknowledged together by a receiver */
+#define TLB_BATCH_MAX_ENTRIES	4
+
+/* Maximum number of distinct fences pending on a receiver */
+#define TLB_BATCH_MAX_OPS	8
+
+struct tlb_batch {
+	u32 count;
+	struct sbi_tlb_info entries[TLB_BATCH_MAX_ENTRIES];
+	struct tlb_coalescer coalescer;
+	struct sbi_tlb_range ops[TLB_BATCH_MAX_OPS];
+};
+
+static void tlb_entry_sync_done(struct sbi_tlb_info *tinfo)
 {
 	u32 rindex;
 	struct sbi_scratch *rscratch = NULL;
 	atomic_t *rtlb_sync = NULL;
 
-	tlb_entry_local_process(tinfo);
-
 	sbi_hartmask_for_each_hartindex(rindex, &tinfo->smask) {
 		rscratch = sbi_hartindex_to_scratch(rindex);
 		if (!rscratch)
@@ -226,117 +569,132 @@ static void tlb_entry_process(struct sbi_tlb_info *tinfo)
 	}
 }
 
-static bool tlb_process_once(struct sbi_scratch *scratch)
+static void tlb_batch_run_ops(struct tlb_batch *batch)
 {
-	struct sbi_tlb_info tinfo;
-	struct sbi_fifo *tlb_fifo =
-			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
+	u32 i;
+	struct tlb_coalescer *c = &batch->coalescer;
 
-	if (!sbi_fifo_dequeue(tlb_fifo, &tinfo)) {
-		tlb_entry_process(&tinfo);
-		return true;
-	}
+	for (i = 0; i < c->nops; i++)
+		tlb_range_local_process(&c->ops[i]);
+	c->nops = 0;
 
-	return false;
+	tlb_coalescer_report(c);
 }
 
-static void tlb_process(struct sbi_scratch *scratch)
+static void tlb_batch_flush(struct tlb_batch *batch)
 {
-	while (tlb_process_once(scratch));
+	u32 i;
+
+	tlb_batch_run_ops(batch);
+
+	/*
+	 * Acknowledge senders only after all flushes are done. Merged
+	 * requests are still acknowledged one by one so the tlb_sync
+	 * accounting of every sender stays exact.
+	 */
+	for (i = 0; i < batch->count; i++)
+		tlb_entry_sync_done(&batch->entries[i]);
+
+	batch->count = 0;
 }
 
-static void tlb_sync(struct sbi_scratch *scratch)
+static void tlb_batch_add_range(struct tlb_batch *batch,
+				const struct sbi_tlb_range *range)
 {
-	atomic_t *tlb_sync =
-			sbi_scratch_offset_ptr(scratch, tlb_sync_off);
+	if (!tlb_coalescer_add(&batch->coalescer, range)) {
+		tlb_batch_run_ops(batch);
+		tlb_coalescer_add(&batch->coalescer, range);
+	}
+}
 
-	while (atomic_read(tlb_sync) > 0) {
-		/*
-		 * While we are waiting for remote hart to set the sync,
-		 * consume fifo requests to avoid deadlock.
-		 */
-		tlb_process_once(scratch);
+static bool tlb_batch_fetch(struct tlb_batch *batch, struct sbi_ring *ring)
+{
+	unsigned long i;
+	struct sbi_tlb_range range;
+	struct sbi_tlb_info *next = &batch->entries[batch->count];
+
+	if (sbi_ring_dequeue(ring, next))
+		return false;
+
+	if (next->type == SBI_TLB_RANGE_BATCH) {
+		for (i = 0; i < next->nranges; i++)
+			tlb_batch_add_range(batch, &next->ranges[i]);
+	} else if (next->type < SBI_TLB_RANGE_BATCH) {
+		range.start = next->start;
+		range.size = next->size;
+		range.asid = next->asid;
+		range.vmid = next->vmid;
+		range.type = next->type;
+		tlb_batch_add_range(batch, &range);
 	}
 
-	return;
+	batch->count++;
+	if (batch->count == TLB_BATCH_MAX_ENTRIES)
+		tlb_batch_flush(batch);
+
+	return true;
 }
 
-static inline int tlb_range_check(struct sbi_tlb_info *curr,
-					struct sbi_tlb_info *next)
+static bool tlb_process_once(struct sbi_scratch *scratch)
 {
-	unsigned long curr_end;
-	unsigned long next_end;
-	int ret = SBI_FIFO_UNCHANGED;
-
-	if (!curr || !next)
-		return ret;
+	u32 w, sender;
+	bool found = false;
+	unsigned long bits;
+	struct tlb_batch batch;
+	struct tlb_queue *tlb_q =
+		sbi_scratch_read_type(scratch, void *, tlb_queue_off);
+
+	batch.count = 0;
+	tlb_coalescer_init(&batch.coalescer, batch.ops, TLB_BATCH_MAX_OPS);
+	for (w = 0; w < array_size(tlb_q->pending.bits); w++) {
+		if (!tlb_q->pending.bits[w])
+			continue;
 
-	next_end = next->start + next->size;
-	curr_end = curr->start + curr->size;
-	if (next->start <= curr->start && next_end > curr_end) {
-		curr->start = next->start;
-		curr->size  = next->size;
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_UPDATED;
-	} else if (next->start >= curr->start && next_end <= curr_end) {
-		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
-		ret = SBI_FIFO_SKIP;
+		bits = atomic_raw_xchg_ulong(&tlb_q->pending.bits[w], 0);
+		while (bits) {
+			sender = w * BITS_PER_LONG + sbi_ffs(bits);
+			bits &= bits - 1;
+			while (tlb_batch_fetch(&batch, &tlb_q->rings[sender]))
+				found = true;
+		}
 	}
 
-	return ret;
+	if (batch.count)
+		tlb_batch_flush(&batch);
+
+	return found;
 }
 
-/**
- * Call back to decide if an inplace fifo update is required or next entry can
- * can be skipped. Here are the different cases that are being handled.
- *
- * Case1:
- *	if next flush request range lies within one of the existing entry, skip
- *	the next entry.
- * Case2:
- *	if flush request range in current fifo entry lies within next flush
- *	request, update the current entry.
- *
- * Note:
- *	We can not issue a fifo reset anymore if a complete vma flush is requested.
- *	This is because we are queueing FENCE.I requests as well now.
- *	To ease up the pressure in enqueue/fifo sync path, try to dequeue 1 element
- *	before continuing the while loop. This method is preferred over wfi/ipi because
- *	of MMIO cost involved in later method.
- */
-static int tlb_update_cb(void *in, void *data)
+static void tlb_process(struct sbi_scratch *scratch)
 {
-	struct sbi_tlb_info *curr;
-	struct sbi_tlb_info *next;
-	int ret = SBI_FIFO_UNCHANGED;
-
-	if (!in || !data)
-		return ret;
+	while (tlb_process_once(scratch));
+}
 
-	curr = (struct sbi_tlb_info *)data;
-	next = (struct sbi_tlb_info *)in;
+static void tlb_sync(struct sbi_scratch *scratch)
+{
+	atomic_t *tlb_sync =
+			sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 
-	if (next->type == SBI_TLB_SFENCE_VMA_ASID &&
-	    curr->type == SBI_TLB_SFENCE_VMA_ASID) {
-		if (next->asid == curr->asid)
-			ret = tlb_range_check(curr, next);
-	} else if (next->type == SBI_TLB_SFENCE_VMA &&
-		   curr->type == SBI_TLB_SFENCE_VMA) {
-		ret = tlb_range_check(curr, next);
+	while (atomic_read(tlb_sync) > 0) {
+		/*
+		 * While we are waiting for remote hart to set the sync,
+		 * consume queued requests to avoid deadlock.
+		 */
+		tlb_process_once(scratch);
 	}
 
-	return ret;
+	return;
 }
 
 static int tlb_update(struct sbi_scratch *scratch,
 			  struct sbi_scratch *remote_scratch,
 			  u32 remote_hartindex, void *data)
 {
-	int ret;
 	atomic_t *tlb_sync;
-	struct sbi_fifo *tlb_fifo_r;
+	struct tlb_queue *tlb_q_r;
 	struct sbi_tlb_info *tinfo = data;
 	u32 curr_hartid = current_hartid();
+	u32 curr_hartindex = scratch->hartindex;
 
 	/*
 	 * If the request is to queue a tlb flush entry for itself
@@ -347,26 +705,27 @@ static int tlb_update(struct sbi_scratch *scratch,
 		return SBI_IPI_UPDATE_BREAK;
 	}
 
-	tlb_fifo_r = sbi_scratch_offset_ptr(remote_scratch, tlb_fifo_off);
-
-	ret = sbi_fifo_inplace_update(tlb_fifo_r, data, tlb_update_cb);
+	tlb_q_r = sbi_scratch_read_type(remote_scratch, void *, tlb_queue_off);
 
-	if (ret == SBI_FIFO_UNCHANGED &&
-	    sbi_fifo_enqueue(tlb_fifo_r, data, false) < 0) {
+	if (sbi_ring_enqueue(&tlb_q_r->rings[curr_hartindex], data)) {
 		/**
-		 * For now, Busy loop until there is space in the fifo.
-		 * There may be case where target hart is also
-		 * enqueue in source hart's fifo. Both hart may busy
-		 * loop leading to a deadlock.
-		 * TODO: Introduce a wait/wakeup event mechanism to handle
-		 * this properly.
+		 * Our ring on the remote hart is full. Drain our own
+		 * queue while waiting because the remote hart may be
+		 * blocked on a request queued to us.
 		 */
 		tlb_process_once(scratch);
-		sbi_dprintf("hart%d: hart%d tlb fifo full\n", curr_hartid,
+		sbi_dprintf("hart%d: hart%d tlb ring full\n", curr_hartid,
 			    sbi_hartindex_to_hartid(remote_hartindex));
 		return SBI_IPI_UPDATE_RETRY;
 	}
 
+	/*
+	 * The release ordering makes the ring entry visible before
+	 * the remote hart can observe our pending bit.
+	 */
+	__atomic_fetch_or(&tlb_q_r->pending.bits[BIT_WORD(curr_hartindex)],
+			  BIT_MASK(curr_hartindex), __ATOMIC_RELEASE);
+
 	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 	atomic_add_return(tlb_sync, 1);
 
@@ -394,7 +753,7 @@ static const u32 tlb_type_to_pmu_fw_event[SBI_TLB_TYPE_MAX] = {
 
 int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 {
-	if (tinfo->type < 0 || tinfo->type >= SBI_TLB_TYPE_MAX)
+	if (tinfo->type < 0 || tinfo->type >= SBI_TLB_RANGE_BATCH)
 		return SBI_EINVAL;
 
 	/*
@@ -412,62 +771,314 @@ int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 	return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
 }
 
+int sbi_tlb_request_batch(ulong hmask, ulong hbase,
+			  struct sbi_tlb_range *ranges, u32 count)
+{
+	u32 i;
+	struct sbi_tlb_info tinfo;
+	struct tlb_coalescer c;
+	struct sbi_tlb_range range;
+
+	if (!ranges || !count || count > SBI_TLB_BATCH_MAX_RANGES)
+		return SBI_EINVAL;
+
+	for (i = 0; i < count; i++) {
+		if (ranges[i].type < 0 || ranges[i].type >= SBI_TLB_RANGE_BATCH)
+			return SBI_EINVAL;
+	}
+
+	sbi_pmu_ctr_add_fw(SBI_PMU_FW_RFENCE_BATCH_RANGES, count);
+
+	/*
+	 * Coalesce the batch in place. A range is always copied out
+	 * before its slot can be reused so the coalescer never runs
+	 * out of space.
+	 */
+	tlb_coalescer_init(&c, ranges, count);
+	for (i = 0; i < count; i++) {
+		range = ranges[i];
+		tlb_coalescer_add(&c, &range);
+	}
+
+	sbi_pmu_ctr_add_fw(SBI_PMU_FW_RFENCE_BATCH_COALESCED,
+			   count - c.nops);
+	tlb_coalescer_report(&c);
+
+	for (i = 0; i < c.nops; i++)
+		sbi_pmu_ctr_incr_fw(tlb_type_to_pmu_fw_event[ranges[i].type]);
+
+	/*
+	 * The remote HARTs read the ranges straight from the caller
+	 * which is fine because sbi_ipi_send_many() waits for all of
+	 * them in tlb_sync() before returning.
+	 */
+	SBI_TLB_INFO_INIT(&tinfo, 0, 0, 0, 0, SBI_TLB_RANGE_BATCH,
+			  current_hartid());
+	tinfo.ranges = ranges;
+	tinfo.nranges = c.nops;
+
+	return sbi_ipi_send_many(hmask, hbase, tlb_event, &tinfo);
+}
+
+#ifdef CONFIG_SBI_TLB_FLUSH_CALIBRATE
+
+/* clang-format off */
+
+#define TLB_CALIBRATE_ROUNDS		8
+#define TLB_CALIBRATE_PAGES		16
+#define TLB_CALIBRATE_MAX_PAGES		512
+
+/* clang-format on */
+
+struct tlb_calibrate_ops {
+	void (*flush_all)(void);
+	void (*flush_page)(unsigned long addr);
+};
+
+static void tlb_calibrate_sfence_vma_page(unsigned long addr)
+{
+	__asm__ __volatile__("sfence.vma %0" : : "r"(addr) : "memory");
+}
+
+static void tlb_calibrate_hfence_gvma_page(unsigned long addr)
+{
+	__sbi_hfence_gvma_gpa(addr >> 2);
+}
+
+static const struct tlb_calibrate_ops tlb_calibrate_ops[] = {
+	[SBI_TLB_FLUSH_LIMIT_SFENCE_VMA] = {
+		.flush_all = tlb_flush_all,
+		.flush_page = tlb_calibrate_sfence_vma_page,
+	},
+	[SBI_TLB_FLUSH_LIMIT_HFENCE_GVMA] = {
+		.flush_all = __sbi_hfence_gvma_all,
+		.flush_page = tlb_calibrate_hfence_gvma_page,
+	},
+	[SBI_TLB_FLUSH_LIMIT_HFENCE_VVMA] = {
+		.flush_all = __sbi_hfence_vvma_all,
+		.flush_page = __sbi_hfence_vvma_va,
+	},
+};
+
+/**
+ * Find the range size where flushing page by page starts to cost more
+ * cycles than a full flush on the calling HART. Only the fences are
+ * timed and not the TLB refills which follow a full flush, so the
+ * result errs towards full flushes. Returns 0 if mcycle is not
+ * counting.
+ */
+static unsigned long tlb_calibrate_limit(enum sbi_tlb_flush_limit_type type)
+{
+	const struct tlb_calibrate_ops *ops = &tlb_calibrate_ops[type];
+	unsigned long i, j, t, pages, addr;
+	unsigned long full = -1UL, range = -1UL;
+
+	/* Any address works, use one which is mapped in most setups */
+	addr = (unsigned long)sbi_scratch_thishart_ptr() & PAGE_MASK;
+
+	for (i = 0; i < TLB_CALIBRATE_ROUNDS; i++) {
+		t = csr_read(CSR_MCYCLE);
+		ops->flush_all();
+		full = MIN(full, csr_read(CSR_MCYCLE) - t);
+
+		t = csr_read(CSR_MCYCLE);
+		for (j = 0; j < TLB_CALIBRATE_PAGES; j++)
+			ops->flush_page(addr + j * PAGE_SIZE);
+		range = MIN(range, csr_read(CSR_MCYCLE) - t);
+	}
+
+	if (!range)
+		return 0;
+
+	pages = (full * TLB_CALIBRATE_PAGES) / range;
+	pages = CLAMP(pages, 1UL, (unsigned long)TLB_CALIBRATE_MAX_PAGES);
+
+	return pages * PAGE_SIZE;
+}
+
+#else
+
+static unsigned long tlb_calibrate_limit(enum sbi_tlb_flush_limit_type type)
+{
+	return 0;
+}
+
+#endif
+
+static void tlb_hart_class_init(struct tlb_hart_class *class,
+				const struct sbi_platform *plat)
+{
+	u32 i;
+	unsigned long limit;
+
+	for (i = 0; i < SBI_TLB_FLUSH_LIMIT_MAX; i++) {
+		if (tlb_flush_limit_override[i]) {
+			limit = tlb_flush_limit_override[i];
+		} else {
+			limit = 0;
+			if (i == SBI_TLB_FLUSH_LIMIT_SFENCE_VMA ||
+			    misa_extension('H'))
+				limit = tlb_calibrate_limit(i);
+			if (!limit)
+				limit = sbi_platform_tlbr_flush_limit(plat);
+		}
+
+		class->limits[i] = limit;
+		tlb_range_flush_limit = MAX(tlb_range_flush_limit, limit);
+	}
+}
+
+static struct tlb_hart_class *tlb_hart_class_get(const struct sbi_platform *plat)
+{
+	struct tlb_hart_class *class;
+	unsigned long mvendorid = csr_read(CSR_MVENDORID);
+	unsigned long marchid = csr_read(CSR_MARCHID);
+	unsigned long mimpid = csr_read(CSR_MIMPID);
+
+	spin_lock(&tlb_hart_class_lock);
+
+	for (class = tlb_hart_classes; class; class = class->next) {
+		if (class->mvendorid == mvendorid &&
+		    class->marchid == marchid &&
+		    class->mimpid == mimpid)
+			goto done;
+	}
+
+	/* First HART of a new class sets the limits for all others */
+	class = sbi_zalloc(sizeof(*class));
+	if (!class)
+		goto done;
+
+	class->mvendorid = mvendorid;
+	class->marchid = marchid;
+	class->mimpid = mimpid;
+	tlb_hart_class_init(class, plat);
+	class->next = tlb_hart_classes;
+	tlb_hart_classes = class;
+
+done:
+	spin_unlock(&tlb_hart_class_lock);
+	return class;
+}
+
+void sbi_tlb_get_flush_limits_str(struct sbi_scratch *scratch,
+				  char *limits_str, int nlimits)
+{
+	u32 i;
+	int offset = 0;
+	struct tlb_hart_class *class;
+
+	if (!limits_str || nlimits <= 0)
+		return;
+	sbi_memset(limits_str, 0, nlimits);
+
+	class = sbi_scratch_read_type(scratch, void *, tlb_class_off);
+	if (!class) {
+		sbi_strncpy(limits_str, "none", nlimits);
+		return;
+	}
+
+	for (i = 0; i < SBI_TLB_FLUSH_LIMIT_MAX && offset < nlimits; i++) {
+		if (i != SBI_TLB_FLUSH_LIMIT_SFENCE_VMA && !misa_extension('H'))
+			continue;
+		offset += sbi_snprintf(limits_str + offset, nlimits - offset,
+				       "%s%s=%luKB", offset ? "," : "",
+				       tlb_flush_limit_names[i],
+				       class->limits[i] / 1024);
+	}
+}
+
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	int ret;
+	u32 i, num_senders;
 	void *tlb_mem;
 	atomic_t *tlb_sync;
-	struct sbi_fifo *tlb_q;
+	struct tlb_queue *tlb_q;
+	struct tlb_hart_class *class;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
+	num_senders = sbi_scratch_last_hartindex() + 1;
+
 	if (cold_boot) {
 		tlb_sync_off = sbi_scratch_alloc_offset(sizeof(*tlb_sync));
 		if (!tlb_sync_off)
 			return SBI_ENOMEM;
-		tlb_fifo_off = sbi_scratch_alloc_offset(sizeof(*tlb_q));
-		if (!tlb_fifo_off) {
+		tlb_queue_off = sbi_scratch_alloc_offset(sizeof(tlb_q));
+		if (!tlb_queue_off) {
 			sbi_scratch_free_offset(tlb_sync_off);
 			return SBI_ENOMEM;
 		}
-		tlb_fifo_mem_off = sbi_scratch_alloc_offset(sizeof(tlb_mem));
-		if (!tlb_fifo_mem_off) {
-			sbi_scratch_free_offset(tlb_fifo_off);
+		tlb_class_off = sbi_scratch_alloc_offset(sizeof(void *));
+		if (!tlb_class_off) {
+			sbi_scratch_free_offset(tlb_queue_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return SBI_ENOMEM;
 		}
 		ret = sbi_ipi_event_create(&tlb_ops);
 		if (ret < 0) {
-			sbi_scratch_free_offset(tlb_fifo_mem_off);
-			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_class_off);
+			sbi_scratch_free_offset(tlb_queue_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return ret;
 		}
 		tlb_event = ret;
 		tlb_range_flush_limit = sbi_platform_tlbr_flush_limit(plat);
+
+		/* The platform may only provide overrides during cold boot */
+		for (i = 0; i < SBI_TLB_FLUSH_LIMIT_MAX; i++)
+			tlb_flush_limit_override[i] =
+				sbi_platform_tlbr_flush_limit_override(plat, i);
+
+		/*
+		 * Split the platform queue depth between all senders but
+		 * keep a useful depth per sender, and round it down to a
+		 * power of two as required by sbi_ring.
+		 */
+		tlb_ring_entries = sbi_platform_tlb_fifo_num_entries(plat) /
+				   num_senders;
+		tlb_ring_entries = 1UL << sbi_fls(MAX(tlb_ring_entries,
+						      SBI_TLB_RING_MIN_ENTRIES));
 	} else {
 		if (!tlb_sync_off ||
-		    !tlb_fifo_off ||
-		    !tlb_fifo_mem_off)
+		    !tlb_queue_off ||
+		    !tlb_class_off ||
+		    !tlb_ring_entries)
 			return SBI_ENOMEM;
 		if (SBI_IPI_EVENT_MAX <= tlb_event)
 			return SBI_ENOSPC;
 	}
 
 	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
-	tlb_q = sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
-	tlb_mem = sbi_scratch_read_type(scratch, void *, tlb_fifo_mem_off);
-	if (!tlb_mem) {
-		tlb_mem = sbi_malloc(
-				sbi_platform_tlb_fifo_num_entries(plat) * SBI_TLB_INFO_SIZE);
-		if (!tlb_mem)
+	tlb_q = sbi_scratch_read_type(scratch, void *, tlb_queue_off);
+	if (!tlb_q) {
+		tlb_q = sbi_zalloc(sizeof(*tlb_q) +
+				   num_senders * sizeof(tlb_q->rings[0]) +
+				   num_senders * tlb_ring_entries *
+				   SBI_TLB_INFO_SIZE);
+		if (!tlb_q)
+			return SBI_ENOMEM;
+		sbi_scratch_write_type(scratch, void *, tlb_queue_off, tlb_q);
+	}
+
+	if (!sbi_scratch_read_type(scratch, void *, tlb_class_off)) {
+		class = tlb_hart_class_get(plat);
+		if (!class)
 			return SBI_ENOMEM;
-		sbi_scratch_write_type(scratch, void *, tlb_fifo_mem_off, tlb_mem);
+		sbi_scratch_write_type(scratch, void *, tlb_class_off, class);
 	}
 
 	ATOMIC_INIT(tlb_sync, 0);
 
-	sbi_fifo_init(tlb_q, tlb_mem,
-		      sbi_platform_tlb_fifo_num_entries(plat), SBI_TLB_INFO_SIZE);
+	SBI_HARTMASK_INIT(&tlb_q->pending);
+	tlb_mem = &tlb_q->rings[num_senders];
+	for (i = 0; i < num_senders; i++) {
+		ret = sbi_ring_init(&tlb_q->rings[i], tlb_mem,
+				    tlb_ring_entries, SBI_TLB_INFO_SIZE);
+		if (ret)
+			return ret;
+		tlb_mem += tlb_ring_entries * SBI_TLB_INFO_SIZE;
+	}
 
 	return 0;
 }
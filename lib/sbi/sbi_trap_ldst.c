@@ -164,6 +164,9 @@ static int sbi_trap_emulate_load(struct sbi_trap_context *tcntx,
 		else
 			SET_F32_RD(insn, regs, val.data_ulong);
 #endif
+	} else {
+		/* As SET_FS_DIRTY() for FP loads, so S-mode saves the new values */
+		regs->mstatus |= MSTATUS_VS;
 	}
 
 	regs->mepc += insn_len;
@@ -274,17 +277,16 @@ static int sbi_misaligned_ld_emulator(int rlen, union sbi_ldst_data *out_val,
 	const struct sbi_trap_info *orig_trap = &tcntx->trap;
 	struct sbi_trap_regs *regs = &tcntx->regs;
 	struct sbi_trap_info uptrap;
-	int i;
-
-	for (i = 0; i < rlen; i++) {
-		out_val->data_bytes[i] =
-			sbi_load_u8((void *)(orig_trap->tval + i), &uptrap);
-		if (uptrap.cause) {
-			uptrap.tinst = sbi_misaligned_tinst_fixup(
-				orig_trap->tinst, uptrap.tinst, i);
-			return sbi_trap_redirect(regs, &uptrap);
-		}
+	ulong done;
+
+	done = sbi_copy_from_user(out_val->data_bytes,
+				  (void *)orig_trap->tval, rlen, &uptrap);
+	if (uptrap.cause) {
+		uptrap.tinst = sbi_misaligned_tinst_fixup(
+			orig_trap->tinst, uptrap.tinst, done);
+		return sbi_trap_redirect(regs, &uptrap);
 	}
+
 	return rlen;
 }
 
@@ -299,17 +301,16 @@ static int sbi_misaligned_st_emulator(int wlen, union sbi_ldst_data in_val,
 	const struct sbi_trap_info *orig_trap = &tcntx->trap;
 	struct sbi_trap_regs *regs = &tcntx->regs;
 	struct sbi_trap_info uptrap;
-	int i;
-
-	for (i = 0; i < wlen; i++) {
-		sbi_store_u8((void *)(orig_trap->tval + i),
-			     in_val.data_bytes[i], &uptrap);
-		if (uptrap.cause) {
-			uptrap.tinst = sbi_misaligned_tinst_fixup(
-				orig_trap->tinst, uptrap.tinst, i);
-			return sbi_trap_redirect(regs, &uptrap);
-		}
+	ulong done;
+
+	done = sbi_copy_to_user((void *)orig_trap->tval, in_val.data_bytes,
+				wlen, &uptrap);
+	if (uptrap.cause) {
+		uptrap.tinst = sbi_misaligned_tinst_fixup(
+			orig_trap->tinst, uptrap.tinst, done);
+		return sbi_trap_redirect(regs, &uptrap);
 	}
+
 	return wlen;
 }
 
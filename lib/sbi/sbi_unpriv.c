@@ -7,6 +7,7 @@
  *   Anup Patel <anup.patel@wdc.com>
  */
 
+#include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
 #include <sbi/sbi_bitops.h>
 #include <sbi/sbi_hart.h>
@@ -17,6 +18,9 @@
 /**
  * a3 must a pointer to the sbi_trap_info and a4 is used as a temporary
  * register in the trap handler. Make sure that compiler doesn't use a3 & a4.
+ *
+ * Shared memory mappings left programmed after sbi_hart_unmap_saddr()
+ * would also apply to MPRV accesses, so they are flushed first.
  */
 #define DEFINE_UNPRIVILEGED_LOAD_FUNCTION(type, insn)                         \
 	type sbi_load_##type(const type *addr,                                \
@@ -26,6 +30,7 @@
 		register ulong mstatus = 0;                                   \
 		register ulong mtvec = sbi_hart_expected_trap_addr();         \
 		type ret = 0;                                                 \
+		sbi_hart_saddr_flush();                                       \
 		trap->cause = 0;                                              \
 		asm volatile(                                                 \
 			"add %[tinfo], %[taddr], zero\n"                      \
@@ -49,9 +54,10 @@
 	void sbi_store_##type(type *addr, type val,                           \
 			      struct sbi_trap_info *trap)                     \
 	{                                                                     \
-		register ulong tinfo asm("a3") = (ulong)trap;                 \
+		register ulong tinfo asm("a3");                               \
 		register ulong mstatus = 0;                                   \
 		register ulong mtvec = sbi_hart_expected_trap_addr();         \
+		sbi_hart_saddr_flush();                                       \
 		trap->cause = 0;                                              \
 		asm volatile(                                                 \
 			"add %[tinfo], %[taddr], zero\n"                      \
@@ -116,6 +122,207 @@ void sbi_store_u64(u64 *addr, u64 val,
 # error "Unexpected __riscv_xlen"
 #endif
 
+/*
+ * Bulk copies install the expected trap handler once and raise MPRV only
+ * around each access to lower privilege memory, so the firmware side of
+ * the copy is accessed normally in between. The expected trap handler
+ * sets a4 to the resume address, so a non-zero a4 means the access
+ * faulted. No further access may follow since the trap changed MPP.
+ */
+static inline bool copy_load_ulong(ulong addr, ulong *val,
+				   struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3") = (ulong)trap;
+	register ulong ttmp asm("a4") = 0;
+	ulong ret;
+
+	asm volatile(
+	    "csrs " STR(CSR_MSTATUS) ", %[mprv]\n"
+	    ".option push\n"
+	    ".option norvc\n"
+	    REG_L " %[ret], 0(%[addr])\n"
+	    ".option pop\n"
+	    "csrc " STR(CSR_MSTATUS) ", %[mprv]"
+	    : [ret] "=&r"(ret), [ttmp] "+&r"(ttmp)
+	    : [mprv] "r"(MSTATUS_MPRV), [addr] "r"(addr), [tinfo] "r"(tinfo)
+	    : "memory");
+
+	*val = ret;
+	return !ttmp;
+}
+
+static inline bool copy_store_ulong(ulong addr, ulong val,
+				    struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3") = (ulong)trap;
+	register ulong ttmp asm("a4") = 0;
+
+	asm volatile(
+	    "csrs " STR(CSR_MSTATUS) ", %[mprv]\n"
+	    ".option push\n"
+	    ".option norvc\n"
+	    REG_S " %[val], 0(%[addr])\n"
+	    ".option pop\n"
+	    "csrc " STR(CSR_MSTATUS) ", %[mprv]"
+	    : [ttmp] "+&r"(ttmp)
+	    : [mprv] "r"(MSTATUS_MPRV), [addr] "r"(addr), [val] "r"(val),
+	      [tinfo] "r"(tinfo)
+	    : "memory");
+
+	return !ttmp;
+}
+
+/* Store the len low bytes of val, returns the number of bytes stored */
+static inline ulong copy_store_bytes(ulong addr, ulong val, ulong len,
+				     struct sbi_trap_info *trap)
+{
+	register ulong tinfo asm("a3") = (ulong)trap;
+	register ulong ttmp asm("a4") = 0;
+	ulong left = len;
+
+	asm volatile(
+	    "csrs " STR(CSR_MSTATUS) ", %[mprv]\n"
+	    ".option push\n"
+	    ".option norvc\n"
+	    "1: sb %[val], 0(%[addr])\n"
+	    "bnez %[ttmp], 2f\n"
+	    "srli %[val], %[val], 8\n"
+	    "addi %[addr], %[addr], 1\n"
+	    "addi %[left], %[left], -1\n"
+	    "bnez %[left], 1b\n"
+	    ".option pop\n"
+	    "2: csrc " STR(CSR_MSTATUS) ", %[mprv]"
+	    : [ttmp] "+&r"(ttmp), [addr] "+&r"(addr), [val] "+&r"(val),
+	      [left] "+&r"(left)
+	    : [mprv] "r"(MSTATUS_MPRV), [tinfo] "r"(tinfo)
+	    : "memory");
+
+	return len - left;
+}
+
+/* Firmware side accesses must stay aligned while MTVEC is swapped */
+static inline void copy_put(u8 *dst, ulong val, ulong len)
+{
+	if (len == sizeof(ulong) && !((ulong)dst & (sizeof(ulong) - 1))) {
+		*(ulong *)dst = val;
+		return;
+	}
+
+	while (len--) {
+		*dst++ = val;
+		val >>= 8;
+	}
+}
+
+static inline ulong copy_get(const u8 *src, ulong len)
+{
+	ulong val = 0;
+
+	if (len == sizeof(ulong) && !((ulong)src & (sizeof(ulong) - 1)))
+		return *(const ulong *)src;
+
+	while (len--)
+		val = (val << 8) | src[len];
+
+	return val;
+}
+
+ulong sbi_copy_from_user(void *dst, const void *src, ulong len,
+			 struct sbi_trap_info *trap)
+{
+	ulong off = (ulong)src & (sizeof(ulong) - 1);
+	ulong addr = (ulong)src - off;
+	ulong mstatus, mtvec, cur, next = 0, val, n, done = 0;
+
+	trap->cause = 0;
+	if (!len)
+		return 0;
+
+	sbi_hart_saddr_flush();
+	mstatus = csr_read(CSR_MSTATUS);
+	mtvec = csr_swap(CSR_MTVEC, sbi_hart_expected_trap_addr());
+
+	/*
+	 * Only naturally aligned words are loaded and the bytes shifted into
+	 * place. An aligned word never straddles a page, so it faults only
+	 * if some byte of the requested range in it does as well.
+	 */
+	if (!copy_load_ulong(addr, &cur, trap))
+		goto out;
+
+	while (done < len) {
+		val = cur >> (off * 8);
+		n = sizeof(ulong) - off;
+		if (len - done > n) {
+			if (!copy_load_ulong(addr + sizeof(ulong), &next, trap)) {
+				copy_put((u8 *)dst + done, val, n);
+				done += n;
+				break;
+			}
+			if (off)
+				val |= next << (n * 8);
+			n = sizeof(ulong);
+		}
+		n = MIN(n, len - done);
+
+		copy_put((u8 *)dst + done, val, n);
+		done += n;
+		addr += sizeof(ulong);
+		cur = next;
+	}
+
+out:
+	csr_write(CSR_MSTATUS, mstatus);
+	csr_write(CSR_MTVEC, mtvec);
+
+	/* A fault in the first word reports its aligned start */
+	if (trap->cause && trap->tval < (ulong)src + done)
+		trap->tval = (ulong)src + done;
+
+	return done;
+}
+
+ulong sbi_copy_to_user(void *dst, const void *src, ulong len,
+		       struct sbi_trap_info *trap)
+{
+	ulong addr = (ulong)dst, mstatus, mtvec, val, n, done = 0;
+
+	trap->cause = 0;
+	if (!len)
+		return 0;
+
+	sbi_hart_saddr_flush();
+	mstatus = csr_read(CSR_MSTATUS);
+	mtvec = csr_swap(CSR_MTVEC, sbi_hart_expected_trap_addr());
+
+	/*
+	 * Bytes up to the first word boundary, whole aligned words, then the
+	 * remaining bytes. Partial words are written byte-wise rather than
+	 * merged with a wide read-modify-write, which could race with other
+	 * HARTs updating the neighbouring bytes.
+	 */
+	while (done < len) {
+		n = sizeof(ulong) - ((addr + done) & (sizeof(ulong) - 1));
+		n = MIN(n, len - done);
+		val = copy_get((const u8 *)src + done, n);
+
+		if (n == sizeof(ulong)) {
+			if (!copy_store_ulong(addr + done, val, trap))
+				break;
+			done += n;
+		} else {
+			done += copy_store_bytes(addr + done, val, n, trap);
+			if (trap->cause)
+				break;
+		}
+	}
+
+	csr_write(CSR_MSTATUS, mstatus);
+	csr_write(CSR_MTVEC, mtvec);
+
+	return done;
+}
+
 ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 {
 	register ulong tinfo asm("a3");
@@ -124,6 +331,7 @@ ulong sbi_get_insn(ulong mepc, struct sbi_trap_info *trap)
 	register ulong mtvec = sbi_hart_expected_trap_addr();
 	ulong insn = 0;
 
+	sbi_hart_saddr_flush();
 	trap->cause = 0;
 
 	asm volatile(
@@ -14,4 +14,25 @@ carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += locks_test_suite
 libsbi-objs-$(CONFIG_SBIUNIT) += tests/riscv_locks_test.o
 
 carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += math_test_suite
-libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_math_test.o
\ No newline at end of file
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_math_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += ring_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_ring_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += hartid_lookup_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_scratch_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += heap_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_heap_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += string_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_string_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += unpriv_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_unpriv_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += timer_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_timer_test.o
+
+carray-sbi_unit_tests-$(CONFIG_SBIUNIT) += domain_test_suite
+libsbi-objs-$(CONFIG_SBIUNIT) += tests/sbi_domain_test.o
@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_unit_test.h>
+
+static const unsigned long test_modes[] = { PRV_M, PRV_S };
+
+static const unsigned long test_access[] = {
+	SBI_DOMAIN_READ,
+	SBI_DOMAIN_WRITE,
+	SBI_DOMAIN_EXECUTE,
+	SBI_DOMAIN_READ | SBI_DOMAIN_WRITE,
+	SBI_DOMAIN_READ | SBI_DOMAIN_MMIO,
+	SBI_DOMAIN_WRITE | SBI_DOMAIN_MMIO,
+};
+
+static unsigned long domain_test_end(const struct sbi_domain_memregion *reg)
+{
+	return (reg->order < __riscv_xlen) ?
+		reg->base + ((1UL << reg->order) - 1) : -1UL;
+}
+
+/* Reference lookup scanning regions in order, the first match decides */
+static const struct sbi_domain_memregion *domain_test_find(
+					const struct sbi_domain *dom,
+					unsigned long addr)
+{
+	const struct sbi_domain_memregion *reg;
+
+	sbi_domain_for_each_memregion(dom, reg) {
+		if (reg->base <= addr && addr <= domain_test_end(reg))
+			return reg;
+	}
+
+	return NULL;
+}
+
+static bool domain_test_check(const struct sbi_domain *dom,
+			      unsigned long addr, unsigned long mode,
+			      unsigned long access, bool need_region)
+{
+	const struct sbi_domain_memregion *reg = domain_test_find(dom, addr);
+	unsigned long rwx = 0, rflags;
+
+	if (!reg)
+		return !need_region && mode == PRV_M;
+
+	if (!(access & SBI_DOMAIN_MMIO) !=
+	    !(reg->flags & SBI_DOMAIN_MEMREGION_MMIO))
+		return false;
+
+	if (access & SBI_DOMAIN_READ)
+		rwx |= SBI_DOMAIN_MEMREGION_M_READABLE;
+	if (access & SBI_DOMAIN_WRITE)
+		rwx |= SBI_DOMAIN_MEMREGION_M_WRITABLE;
+	if (access & SBI_DOMAIN_EXECUTE)
+		rwx |= SBI_DOMAIN_MEMREGION_M_EXECUTABLE;
+
+	rflags = (mode == PRV_M) ?
+		 (reg->flags & SBI_DOMAIN_MEMREGION_M_ACCESS_MASK) :
+		 ((reg->flags & SBI_DOMAIN_MEMREGION_SU_ACCESS_MASK) >>
+		  SBI_DOMAIN_MEMREGION_SU_ACCESS_SHIFT);
+
+	return (rflags & rwx) == rwx;
+}
+
+/* A range is allowed when its start and every boundary inside it are */
+static bool domain_test_check_range(const struct sbi_domain *dom,
+				    unsigned long addr, unsigned long last,
+				    unsigned long mode, unsigned long access)
+{
+	const struct sbi_domain_memregion *reg;
+	unsigned long end;
+
+	if (!domain_test_check(dom, addr, mode, access, true))
+		return false;
+
+	sbi_domain_for_each_memregion(dom, reg) {
+		end = domain_test_end(reg);
+		if (addr < reg->base && reg->base <= last &&
+		    !domain_test_check(dom, reg->base, mode, access, true))
+			return false;
+		if (end != -1UL && addr <= end && end < last &&
+		    !domain_test_check(dom, end + 1, mode, access, true))
+			return false;
+	}
+
+	return true;
+}
+
+static void domain_check_addr_test(struct sbiunit_test_case *test)
+{
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	const struct sbi_domain_memregion *reg;
+	unsigned long addrs[4];
+	u32 m, a, i;
+	bool ok = true;
+
+	SBIUNIT_ASSERT(test, dom);
+	SBIUNIT_EXPECT(test, dom->ranges && dom->range_count);
+
+	/* Both sides of every region boundary */
+	sbi_domain_for_each_memregion(dom, reg) {
+		addrs[0] = reg->base - 1;
+		addrs[1] = reg->base;
+		addrs[2] = domain_test_end(reg);
+		addrs[3] = domain_test_end(reg) + 1;
+
+		for (i = 0; i < array_size(addrs); i++) {
+			for (m = 0; m < array_size(test_modes); m++) {
+				for (a = 0; a < array_size(test_access); a++) {
+					ok &= sbi_domain_check_addr(dom,
+						addrs[i], test_modes[m],
+						test_access[a]) ==
+					      domain_test_check(dom, addrs[i],
+						test_modes[m], test_access[a],
+						false);
+				}
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static void domain_check_addr_range_test(struct sbiunit_test_case *test)
+{
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	const struct sbi_domain_memregion *reg;
+	unsigned long base, last;
+	u32 m, a;
+	bool ok = true;
+
+	SBIUNIT_ASSERT(test, dom);
+
+	/* Ranges straddling the start of each region and spanning it */
+	sbi_domain_for_each_memregion(dom, reg) {
+		base = reg->base ? reg->base - 8 : 0;
+		last = domain_test_end(reg);
+		if (last != -1UL)
+			last += 8;
+
+		for (m = 0; m < array_size(test_modes); m++) {
+			for (a = 0; a < array_size(test_access); a++) {
+				/* Skip sizes not fitting an unsigned long */
+				if (last - base + 1)
+					ok &= sbi_domain_check_addr_range(dom,
+						base, last - base + 1,
+						test_modes[m], test_access[a]) ==
+					      domain_test_check_range(dom, base,
+						last, test_modes[m],
+						test_access[a]);
+				ok &= sbi_domain_check_addr_range(dom,
+						reg->base, 8, test_modes[m],
+						test_access[a]) ==
+				      domain_test_check_range(dom, reg->base,
+						reg->base + 7, test_modes[m],
+						test_access[a]);
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+	SBIUNIT_EXPECT(test, sbi_domain_check_addr_range(dom, 0x1000, 0,
+							 PRV_S,
+							 SBI_DOMAIN_READ));
+	SBIUNIT_EXPECT(test, !sbi_domain_check_addr_range(dom, -8UL, 16,
+							  PRV_M,
+							  SBI_DOMAIN_READ));
+}
+
+static struct sbiunit_test_case domain_test_cases[] = {
+	SBIUNIT_TEST_CASE(domain_check_addr_test),
+	SBIUNIT_TEST_CASE(domain_check_addr_range_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(domain_test_suite, domain_test_cases);
@@ -0,0 +1,184 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/sbi_heap.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_unit_test.h>
+
+#define HEAP_TEST_SIZE		(12 * 1024)
+#define HEAP_TEST_OBJS		40
+#define HEAP_TEST_MIXED_OBJS	24
+
+static struct sbi_heap_control *test_hpctrl;
+static void *test_heap_mem;
+static void *objs[HEAP_TEST_OBJS];
+
+/* Run every test on a fresh heap carved out of the global heap */
+static bool heap_test_setup(struct sbiunit_test_case *test)
+{
+	test_heap_mem = sbi_aligned_alloc(HEAP_BASE_ALIGN, HEAP_TEST_SIZE);
+	sbi_heap_alloc_new(&test_hpctrl);
+	if (!test_heap_mem || !test_hpctrl ||
+	    sbi_heap_init_new(test_hpctrl, (unsigned long)test_heap_mem,
+			      HEAP_TEST_SIZE)) {
+		sbi_free(test_hpctrl);
+		sbi_free(test_heap_mem);
+		return false;
+	}
+
+	return true;
+}
+
+static void heap_test_cleanup(void)
+{
+	sbi_free(test_hpctrl);
+	sbi_free(test_heap_mem);
+}
+
+static unsigned long heap_test_capacity(void)
+{
+	return HEAP_TEST_SIZE - sbi_heap_reserved_space_from(test_hpctrl);
+}
+
+static void heap_alloc_free_test(struct sbiunit_test_case *test)
+{
+	unsigned long free_space;
+	u32 i;
+
+	SBIUNIT_ASSERT(test, heap_test_setup(test));
+	free_space = sbi_heap_free_space_from(test_hpctrl);
+	SBIUNIT_EXPECT(test, free_space <= heap_test_capacity());
+
+	SBIUNIT_EXPECT(test, !sbi_malloc_from(test_hpctrl, 0));
+	SBIUNIT_EXPECT(test, !sbi_malloc_from(test_hpctrl, HEAP_TEST_SIZE));
+
+	/* Mix of slab and block sized allocations */
+	for (i = 0; i < HEAP_TEST_MIXED_OBJS; i++) {
+		objs[i] = sbi_zalloc_from(test_hpctrl, 8 + (i % 8) * 40);
+		SBIUNIT_EXPECT(test, objs[i]);
+		SBIUNIT_EXPECT(test, !((unsigned long)objs[i] & 63));
+		if (objs[i])
+			sbi_memset(objs[i], i, 8 + (i % 8) * 40);
+	}
+
+	for (i = 0; i < HEAP_TEST_MIXED_OBJS; i++) {
+		if (objs[i])
+			SBIUNIT_EXPECT_EQ(test, *(u8 *)objs[i], (u8)i);
+	}
+
+	/* Free in an interleaved order to exercise coalescing */
+	for (i = 0; i < HEAP_TEST_MIXED_OBJS; i += 2)
+		sbi_free_from(test_hpctrl, objs[i]);
+	for (i = 1; i < HEAP_TEST_MIXED_OBJS; i += 2)
+		sbi_free_from(test_hpctrl, objs[i]);
+
+	/* Only the overhead of one empty slab per class remains in use */
+	SBIUNIT_EXPECT(test, sbi_heap_free_space_from(test_hpctrl) <=
+			     free_space);
+	SBIUNIT_EXPECT(test, sbi_heap_free_space_from(test_hpctrl) +
+			     HEAP_BASE_ALIGN >= free_space);
+	SBIUNIT_EXPECT(test, sbi_heap_peak_used_space_from(test_hpctrl) >
+			     sbi_heap_used_space_from(test_hpctrl));
+
+	heap_test_cleanup();
+}
+
+static void heap_coalesce_test(struct sbiunit_test_case *test)
+{
+	unsigned long largest;
+	void *a, *b, *c;
+
+	SBIUNIT_ASSERT(test, heap_test_setup(test));
+	largest = sbi_heap_largest_free_space_from(test_hpctrl);
+
+	a = sbi_malloc_from(test_hpctrl, 2048);
+	b = sbi_malloc_from(test_hpctrl, 2048);
+	c = sbi_malloc_from(test_hpctrl, 2048);
+	SBIUNIT_ASSERT(test, a && b && c);
+	SBIUNIT_EXPECT(test, a < b && b < c);
+
+	/* A hole between two used blocks shows up as fragmentation */
+	sbi_free_from(test_hpctrl, b);
+	SBIUNIT_EXPECT(test, sbi_heap_largest_free_space_from(test_hpctrl) <
+			     sbi_heap_free_space_from(test_hpctrl));
+
+	/* Address ordered first fit reuses the hole */
+	b = sbi_malloc_from(test_hpctrl, 1024);
+	SBIUNIT_EXPECT(test, b && a < b && b < c);
+
+	sbi_free_from(test_hpctrl, a);
+	sbi_free_from(test_hpctrl, c);
+	sbi_free_from(test_hpctrl, b);
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_largest_free_space_from(test_hpctrl),
+			  largest);
+
+	heap_test_cleanup();
+}
+
+static void heap_aligned_alloc_test(struct sbiunit_test_case *test)
+{
+	unsigned long free_space;
+	void *a, *b;
+
+	SBIUNIT_ASSERT(test, heap_test_setup(test));
+	free_space = sbi_heap_free_space_from(test_hpctrl);
+
+	SBIUNIT_EXPECT(test, !sbi_aligned_alloc_from(test_hpctrl, 96, 96));
+	SBIUNIT_EXPECT(test, !sbi_aligned_alloc_from(test_hpctrl, 256, 100));
+
+	a = sbi_malloc_from(test_hpctrl, 1024);
+	b = sbi_aligned_alloc_from(test_hpctrl, 4096, 4096);
+	SBIUNIT_ASSERT(test, a && b);
+	SBIUNIT_EXPECT(test, !((unsigned long)b & 4095));
+
+	sbi_free_from(test_hpctrl, a);
+	sbi_free_from(test_hpctrl, b);
+	SBIUNIT_EXPECT_EQ(test, sbi_heap_free_space_from(test_hpctrl),
+			  free_space);
+
+	heap_test_cleanup();
+}
+
+static void heap_slab_test(struct sbiunit_test_case *test)
+{
+	unsigned long free_space;
+	u32 i, count = 0;
+
+	SBIUNIT_ASSERT(test, heap_test_setup(test));
+	free_space = sbi_heap_free_space_from(test_hpctrl);
+
+	/* Enough objects of one class to need more than one slab */
+	for (i = 0; i < HEAP_TEST_OBJS; i++) {
+		objs[i] = sbi_malloc_from(test_hpctrl, 64);
+		if (objs[i])
+			count++;
+	}
+	SBIUNIT_EXPECT_EQ(test, count, HEAP_TEST_OBJS);
+
+	/* Slab objects are handed out once */
+	for (i = 1; i < HEAP_TEST_OBJS; i++)
+		SBIUNIT_EXPECT(test, objs[i] != objs[i - 1]);
+
+	for (i = 0; i < HEAP_TEST_OBJS; i++)
+		sbi_free_from(test_hpctrl, objs[i]);
+
+	/* One empty slab may be kept per class */
+	SBIUNIT_EXPECT(test, sbi_heap_free_space_from(test_hpctrl) <=
+			     free_space);
+	SBIUNIT_EXPECT(test, sbi_heap_free_space_from(test_hpctrl) +
+			     HEAP_BASE_ALIGN >= free_space);
+
+	heap_test_cleanup();
+}
+
+static struct sbiunit_test_case heap_test_cases[] = {
+	SBIUNIT_TEST_CASE(heap_alloc_free_test),
+	SBIUNIT_TEST_CASE(heap_coalesce_test),
+	SBIUNIT_TEST_CASE(heap_aligned_alloc_test),
+	SBIUNIT_TEST_CASE(heap_slab_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(heap_test_suite, heap_test_cases);
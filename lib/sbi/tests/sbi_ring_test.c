@@ -0,0 +1,196 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_ring.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_unit_test.h>
+
+#define RING_TEST_ENTRIES	8
+#define RING_TEST_SENDERS	SBI_HARTMASK_MAX_BITS
+#define RING_TEST_ROUNDS	1000
+
+struct ring_test_entry {
+	u32 sender;
+	u32 seq;
+	unsigned long payload[3];
+};
+
+static struct ring_test_entry ring_mem[RING_TEST_SENDERS][RING_TEST_ENTRIES];
+static struct sbi_ring rings[RING_TEST_SENDERS];
+static u32 sent_seq[RING_TEST_SENDERS];
+static u32 recv_seq[RING_TEST_SENDERS];
+
+static void ring_test_fill(struct ring_test_entry *e, u32 sender, u32 seq)
+{
+	e->sender = sender;
+	e->seq = seq;
+	e->payload[0] = seq;
+	e->payload[1] = ~(unsigned long)seq;
+	e->payload[2] = ((unsigned long)sender << 16) | (seq & 0xffff);
+}
+
+static bool ring_test_check(struct ring_test_entry *e, u32 sender, u32 seq)
+{
+	struct ring_test_entry exp;
+
+	ring_test_fill(&exp, sender, seq);
+	return !sbi_memcmp(e, &exp, sizeof(exp));
+}
+
+static void ring_init_test(struct sbiunit_test_case *test)
+{
+	struct sbi_ring ring;
+
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_init(&ring, ring_mem[0], 6,
+					      sizeof(ring_mem[0][0])),
+			  SBI_EINVAL);
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_init(&ring, ring_mem[0], 0,
+					      sizeof(ring_mem[0][0])),
+			  SBI_EINVAL);
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_init(&ring, NULL, RING_TEST_ENTRIES,
+					      sizeof(ring_mem[0][0])),
+			  SBI_EINVAL);
+	SBIUNIT_ASSERT_EQ(test, sbi_ring_init(&ring, ring_mem[0], 1,
+					      sizeof(ring_mem[0][0])), 0);
+	SBIUNIT_ASSERT_EQ(test, sbi_ring_init(&ring, ring_mem[0],
+					      RING_TEST_ENTRIES,
+					      sizeof(ring_mem[0][0])), 0);
+	SBIUNIT_EXPECT(test, sbi_ring_is_empty(&ring));
+	SBIUNIT_EXPECT(test, !sbi_ring_is_full(&ring));
+}
+
+static void ring_full_empty_test(struct sbiunit_test_case *test)
+{
+	u32 i;
+	struct sbi_ring ring;
+	struct ring_test_entry e;
+
+	SBIUNIT_ASSERT_EQ(test, sbi_ring_init(&ring, ring_mem[0],
+					      RING_TEST_ENTRIES,
+					      sizeof(ring_mem[0][0])), 0);
+
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_dequeue(&ring, &e), SBI_ENOENT);
+
+	for (i = 0; i < RING_TEST_ENTRIES; i++) {
+		ring_test_fill(&e, 0, i);
+		SBIUNIT_EXPECT_EQ(test, sbi_ring_enqueue(&ring, &e), 0);
+	}
+	SBIUNIT_EXPECT(test, sbi_ring_is_full(&ring));
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_avail(&ring), RING_TEST_ENTRIES);
+
+	ring_test_fill(&e, 0, i);
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_enqueue(&ring, &e), SBI_ENOSPC);
+
+	for (i = 0; i < RING_TEST_ENTRIES; i++) {
+		SBIUNIT_EXPECT_EQ(test, sbi_ring_dequeue(&ring, &e), 0);
+		SBIUNIT_EXPECT(test, ring_test_check(&e, 0, i));
+	}
+	SBIUNIT_EXPECT(test, sbi_ring_is_empty(&ring));
+	SBIUNIT_EXPECT_EQ(test, sbi_ring_dequeue(&ring, &e), SBI_ENOENT);
+}
+
+static void ring_index_wrap_test(struct sbiunit_test_case *test)
+{
+	u32 i, next = 0;
+	struct sbi_ring ring;
+	struct ring_test_entry e;
+
+	SBIUNIT_ASSERT_EQ(test, sbi_ring_init(&ring, ring_mem[0],
+					      RING_TEST_ENTRIES,
+					      sizeof(ring_mem[0][0])), 0);
+
+	/* Start just below the 32-bit wrap of the free running indices */
+	ring.head = ring.tail = -3U;
+
+	/* Leave one more entry queued every third step until full */
+	for (i = 0; i < 3 * RING_TEST_ENTRIES; i++) {
+		ring_test_fill(&e, 0, i);
+		SBIUNIT_ASSERT_EQ(test, sbi_ring_enqueue(&ring, &e), 0);
+		if (i % 3 == 2)
+			continue;
+		SBIUNIT_ASSERT_EQ(test, sbi_ring_dequeue(&ring, &e), 0);
+		SBIUNIT_EXPECT(test, ring_test_check(&e, 0, next));
+		next++;
+	}
+	SBIUNIT_EXPECT(test, sbi_ring_is_full(&ring));
+
+	while (!sbi_ring_dequeue(&ring, &e)) {
+		SBIUNIT_EXPECT(test, ring_test_check(&e, 0, next));
+		next++;
+	}
+	SBIUNIT_EXPECT_EQ(test, next, 3 * RING_TEST_ENTRIES);
+	SBIUNIT_EXPECT(test, sbi_ring_is_empty(&ring));
+}
+
+/*
+ * Model the TLB request pattern: every sender hart index owns one ring
+ * towards a single receiver. Senders push bursts until their ring is
+ * full while the receiver drains the rings fully or partially on
+ * alternate rounds. Every ring must deliver exactly what its sender
+ * pushed, in order.
+ */
+static void ring_all_senders_stress_test(struct sbiunit_test_case *test)
+{
+	u32 s, r, nsenders = sbi_scratch_last_hartindex() + 1;
+	struct ring_test_entry e;
+	bool ok = true;
+
+	if (nsenders < 2)
+		nsenders = RING_TEST_SENDERS;
+
+	for (s = 0; s < nsenders; s++) {
+		SBIUNIT_ASSERT_EQ(test, sbi_ring_init(&rings[s], ring_mem[s],
+						      RING_TEST_ENTRIES,
+						      sizeof(e)), 0);
+		sent_seq[s] = recv_seq[s] = 0;
+	}
+
+	for (r = 0; r < RING_TEST_ROUNDS; r++) {
+		for (s = 0; s < nsenders; s++) {
+			/* Vary the burst length of each sender per round */
+			u32 burst = 1 + ((r + s) % RING_TEST_ENTRIES);
+
+			while (burst--) {
+				ring_test_fill(&e, s, sent_seq[s]);
+				if (sbi_ring_enqueue(&rings[s], &e))
+					break;
+				sent_seq[s]++;
+			}
+		}
+
+		for (s = 0; s < nsenders; s++) {
+			/* Drain only part of the rings on odd rounds */
+			u32 budget = (r & 1) ? RING_TEST_ENTRIES / 2 : -1U;
+
+			while (budget-- && !sbi_ring_dequeue(&rings[s], &e)) {
+				ok &= ring_test_check(&e, s, recv_seq[s]);
+				recv_seq[s]++;
+			}
+		}
+	}
+
+	for (s = 0; s < nsenders; s++) {
+		while (!sbi_ring_dequeue(&rings[s], &e)) {
+			ok &= ring_test_check(&e, s, recv_seq[s]);
+			recv_seq[s]++;
+		}
+		SBIUNIT_EXPECT_EQ(test, recv_seq[s], sent_seq[s]);
+		SBIUNIT_EXPECT(test, sbi_ring_is_empty(&rings[s]));
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static struct sbiunit_test_case ring_test_cases[] = {
+	SBIUNIT_TEST_CASE(ring_init_test),
+	SBIUNIT_TEST_CASE(ring_full_empty_test),
+	SBIUNIT_TEST_CASE(ring_index_wrap_test),
+	SBIUNIT_TEST_CASE(ring_all_senders_stress_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(ring_test_suite, ring_test_cases);
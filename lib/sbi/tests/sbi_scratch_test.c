@@ -0,0 +1,127 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_unit_test.h>
+
+static u32 saved_hartids[SBI_HARTMASK_MAX_BITS];
+static u32 saved_last_hartindex;
+
+/* Install a HART id layout and rebuild the lookup for it */
+static void hartid_layout_set(const u32 *hartids, u32 count)
+{
+	saved_last_hartindex = last_hartindex_having_scratch;
+	sbi_memcpy(saved_hartids, hartindex_to_hartid_table,
+		   sizeof(saved_hartids));
+
+	sbi_memcpy(hartindex_to_hartid_table, hartids, count * sizeof(u32));
+	last_hartindex_having_scratch = count - 1;
+	sbi_scratch_hartid_lookup_init();
+}
+
+static void hartid_layout_restore(void)
+{
+	sbi_memcpy(hartindex_to_hartid_table, saved_hartids,
+		   sizeof(saved_hartids));
+	last_hartindex_having_scratch = saved_last_hartindex;
+	sbi_scratch_hartid_lookup_init();
+}
+
+static bool hartid_layout_check(const u32 *hartids, u32 count)
+{
+	u32 i;
+
+	for (i = 0; i < count; i++) {
+		if (sbi_hartid_to_hartindex(hartids[i]) != i)
+			return false;
+	}
+
+	return true;
+}
+
+static void hartid_lookup_dense_test(struct sbiunit_test_case *test)
+{
+	u32 i, hartids[SBI_HARTMASK_MAX_BITS];
+	bool ok;
+
+	for (i = 0; i < SBI_HARTMASK_MAX_BITS; i++)
+		hartids[i] = i;
+
+	hartid_layout_set(hartids, SBI_HARTMASK_MAX_BITS);
+	ok = hartid_layout_check(hartids, SBI_HARTMASK_MAX_BITS);
+	i = sbi_hartid_to_hartindex(SBI_HARTMASK_MAX_BITS);
+	hartid_layout_restore();
+
+	SBIUNIT_EXPECT(test, ok);
+	SBIUNIT_EXPECT_EQ(test, i, -1U);
+}
+
+static void hartid_lookup_sparse_test(struct sbiunit_test_case *test)
+{
+	u32 i, hartids[SBI_HARTMASK_MAX_BITS];
+	u32 miss_cluster, miss_high;
+	bool ok;
+
+	/*
+	 * Multi-cluster layout with the cluster number in bits above the
+	 * hash size so HART ids of different clusters fold onto the same
+	 * slots, plus a few HART ids near the top of the 32-bit range.
+	 */
+	for (i = 0; i < SBI_HARTMASK_MAX_BITS - 4; i++)
+		hartids[i] = ((i / 8) << 16) | ((i / 8) << 8) | (i % 8);
+	hartids[i++] = 0x7fffffff;
+	hartids[i++] = 0xfffffffe;
+	hartids[i++] = 0x80000000;
+	hartids[i++] = 0x300;
+
+	hartid_layout_set(hartids, SBI_HARTMASK_MAX_BITS);
+	ok = hartid_layout_check(hartids, SBI_HARTMASK_MAX_BITS);
+	miss_cluster = sbi_hartid_to_hartindex((1 << 16) | 8);
+	miss_high = sbi_hartid_to_hartindex(0xfffffffd);
+	hartid_layout_restore();
+
+	SBIUNIT_EXPECT(test, ok);
+	SBIUNIT_EXPECT_EQ(test, miss_cluster, -1U);
+	SBIUNIT_EXPECT_EQ(test, miss_high, -1U);
+}
+
+static void hartid_lookup_few_harts_test(struct sbiunit_test_case *test)
+{
+	static const u32 hartids[] = { 0x1000, 0x2000, 0 };
+	u32 miss;
+	bool ok;
+
+	hartid_layout_set(hartids, array_size(hartids));
+	ok = hartid_layout_check(hartids, array_size(hartids));
+	miss = sbi_hartid_to_hartindex(1);
+	hartid_layout_restore();
+
+	SBIUNIT_EXPECT(test, ok);
+	SBIUNIT_EXPECT_EQ(test, miss, -1U);
+}
+
+static void hartid_lookup_current_test(struct sbiunit_test_case *test)
+{
+	u32 i;
+
+	for (i = 0; i <= sbi_scratch_last_hartindex(); i++)
+		SBIUNIT_EXPECT_EQ(test,
+			sbi_hartid_to_hartindex(sbi_hartindex_to_hartid(i)), i);
+
+	SBIUNIT_EXPECT_EQ(test, sbi_hartid_to_hartindex(current_hartid()),
+			  current_hartindex());
+}
+
+static struct sbiunit_test_case hartid_lookup_test_cases[] = {
+	SBIUNIT_TEST_CASE(hartid_lookup_dense_test),
+	SBIUNIT_TEST_CASE(hartid_lookup_sparse_test),
+	SBIUNIT_TEST_CASE(hartid_lookup_few_harts_test),
+	SBIUNIT_TEST_CASE(hartid_lookup_current_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(hartid_lookup_test_suite, hartid_lookup_test_cases);
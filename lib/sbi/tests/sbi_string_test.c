@@ -0,0 +1,233 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_unit_test.h>
+
+#define STRING_TEST_BUF		4096
+#define STRING_TEST_PAD		64
+#define STRING_TEST_GUARD	0xa5
+
+static unsigned char buf_src[STRING_TEST_BUF + STRING_TEST_PAD];
+static unsigned char buf_dst[STRING_TEST_BUF + STRING_TEST_PAD];
+static unsigned char buf_ref[STRING_TEST_BUF + STRING_TEST_PAD];
+
+/*
+ * Lengths around the word, unrolled loop and vector copy thresholds
+ * plus a few odd sizes in between.
+ */
+static const size_t test_lens[] = {
+	0, 1, 2, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65,
+	100, 255, 1023, 1024, 1025, 2051, STRING_TEST_BUF - 8,
+};
+
+static void string_test_fill(unsigned char *buf, size_t len, u32 seed)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (unsigned char)(seed + i * 7 + (i >> 8));
+}
+
+/* Byte-wise reference copy, safe for any overlap */
+static void string_ref_move(unsigned char *dst, const unsigned char *src,
+			    size_t len)
+{
+	size_t i;
+
+	if (dst < src) {
+		for (i = 0; i < len; i++)
+			dst[i] = src[i];
+	} else {
+		for (i = len; i > 0; i--)
+			dst[i - 1] = src[i - 1];
+	}
+}
+
+static bool string_check(const unsigned char *buf, const unsigned char *ref,
+			 size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (buf[i] != ref[i])
+			return false;
+	}
+
+	return true;
+}
+
+static void string_memcpy_test(struct sbiunit_test_case *test)
+{
+	u32 soff, doff, l;
+	size_t len;
+	bool ok = true;
+
+	string_test_fill(buf_src, sizeof(buf_src), 3);
+
+	for (soff = 0; soff < sizeof(unsigned long); soff++) {
+		for (doff = 0; doff < sizeof(unsigned long); doff++) {
+			for (l = 0; l < array_size(test_lens); l++) {
+				len = test_lens[l];
+				sbi_memset(buf_ref, STRING_TEST_GUARD,
+					   sizeof(buf_ref));
+				string_ref_move(buf_ref + doff, buf_src + soff,
+						len);
+
+				string_ref_move(buf_dst, buf_ref,
+						sizeof(buf_dst));
+				sbi_memset(buf_dst + doff, STRING_TEST_GUARD,
+					   len);
+				sbi_memcpy(buf_dst + doff, buf_src + soff, len);
+				ok &= string_check(buf_dst, buf_ref,
+						   sizeof(buf_dst));
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static void string_memmove_test(struct sbiunit_test_case *test)
+{
+	int shift;
+	u32 off, l;
+	size_t len;
+	bool ok = true;
+
+	/* Overlapping moves in both directions, including odd distances */
+	for (shift = -17; shift <= 17; shift++) {
+		for (off = 0; off < sizeof(unsigned long); off++) {
+			for (l = 0; l < array_size(test_lens); l++) {
+				len = test_lens[l];
+				string_test_fill(buf_ref, sizeof(buf_ref),
+						 shift + off);
+				string_ref_move(buf_dst, buf_ref,
+						sizeof(buf_dst));
+				string_ref_move(buf_ref + 17 + off + shift,
+						buf_ref + 17 + off, len);
+
+				sbi_memmove(buf_dst + 17 + off + shift,
+					    buf_dst + 17 + off, len);
+				ok &= string_check(buf_dst, buf_ref,
+						   sizeof(buf_dst));
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static void string_memset_test(struct sbiunit_test_case *test)
+{
+	u32 off, l, c = 0;
+	size_t i, len;
+	bool ok = true;
+
+	for (off = 0; off < sizeof(unsigned long); off++) {
+		for (l = 0; l < array_size(test_lens); l++) {
+			len = test_lens[l];
+			c = (c + 0x35) & 0xff;
+
+			string_test_fill(buf_ref, sizeof(buf_ref), l);
+			string_ref_move(buf_dst, buf_ref, sizeof(buf_dst));
+			for (i = 0; i < len; i++)
+				buf_ref[off + i] = c;
+
+			/* Only the low byte of the value is used */
+			SBIUNIT_EXPECT_EQ(test,
+				sbi_memset(buf_dst + off, c | 0x100, len),
+				buf_dst + off);
+			ok &= string_check(buf_dst, buf_ref, sizeof(buf_dst));
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static int string_sign(int val)
+{
+	return (val > 0) - (val < 0);
+}
+
+static void string_memcmp_test(struct sbiunit_test_case *test)
+{
+	u32 soff, doff, l;
+	size_t len, pos;
+	bool ok = true;
+
+	string_test_fill(buf_src, sizeof(buf_src), 11);
+
+	for (soff = 0; soff < sizeof(unsigned long); soff++) {
+		for (doff = 0; doff < sizeof(unsigned long); doff++) {
+			for (l = 0; l < array_size(test_lens); l++) {
+				len = test_lens[l];
+				string_ref_move(buf_dst + doff, buf_src + soff,
+						len);
+				ok &= !sbi_memcmp(buf_dst + doff,
+						  buf_src + soff, len);
+				if (!len)
+					continue;
+
+				/* Differences at the start, middle and end */
+				for (pos = 0; pos < len; pos += len / 2 + 1) {
+					buf_dst[doff + pos] ^= 0x80;
+					ok &= string_sign(sbi_memcmp(
+						buf_dst + doff, buf_src + soff,
+						len)) ==
+					      string_sign(buf_dst[doff + pos] -
+							  buf_src[soff + pos]);
+					buf_dst[doff + pos] ^= 0x80;
+				}
+				buf_dst[doff + len - 1]++;
+				ok &= sbi_memcmp(buf_dst + doff, buf_src + soff,
+						 len) != 0;
+				ok &= !sbi_memcmp(buf_dst + doff,
+						  buf_src + soff, len - 1);
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static void string_strlen_test(struct sbiunit_test_case *test)
+{
+	u32 off;
+	size_t len;
+	bool ok = true;
+
+	for (off = 0; off < sizeof(unsigned long); off++) {
+		for (len = 0; len < 4 * sizeof(unsigned long) + 3; len++) {
+			/*
+			 * Bytes of 0x80 and 0x01 around the terminator trip
+			 * up naive zero byte detection.
+			 */
+			sbi_memset(buf_dst, 0x80, STRING_TEST_PAD);
+			sbi_memset(buf_dst + off, 0x01, len / 2);
+			buf_dst[off + len] = '\0';
+			ok &= sbi_strlen((char *)buf_dst + off) == len;
+			ok &= sbi_strnlen((char *)buf_dst + off, len + 1) ==
+			      len;
+		}
+	}
+
+	sbi_memset(buf_dst, 'a', STRING_TEST_BUF);
+	buf_dst[STRING_TEST_BUF - 1] = '\0';
+	ok &= sbi_strlen((char *)buf_dst + 1) == STRING_TEST_BUF - 2;
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static struct sbiunit_test_case string_test_cases[] = {
+	SBIUNIT_TEST_CASE(string_memcpy_test),
+	SBIUNIT_TEST_CASE(string_memmove_test),
+	SBIUNIT_TEST_CASE(string_memset_test),
+	SBIUNIT_TEST_CASE(string_memcmp_test),
+	SBIUNIT_TEST_CASE(string_strlen_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(string_test_suite, string_test_cases);
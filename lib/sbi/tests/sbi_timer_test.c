@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_timer.h>
+#include <sbi/sbi_unit_test.h>
+
+#define TIMER_TEST_EVENTS	4
+
+static struct sbi_timer_event test_events[TIMER_TEST_EVENTS];
+static u32 test_order[TIMER_TEST_EVENTS];
+static u32 test_fired;
+
+static void timer_test_callback(struct sbi_timer_event *ev)
+{
+	if (test_fired < TIMER_TEST_EVENTS)
+		test_order[test_fired] = ev - test_events;
+	test_fired++;
+}
+
+static void timer_test_reset(void)
+{
+	u32 i;
+
+	for (i = 0; i < TIMER_TEST_EVENTS; i++) {
+		sbi_timer_event_init(&test_events[i], timer_test_callback);
+		test_order[i] = -1U;
+	}
+	test_fired = 0;
+}
+
+static void timer_event_order_test(struct sbiunit_test_case *test)
+{
+	u64 now = sbi_timer_value();
+
+	timer_test_reset();
+
+	/* Expired events run in deadline order, later ones stay queued */
+	SBIUNIT_EXPECT_EQ(test, sbi_timer_event_add(&test_events[0], now), 0);
+	SBIUNIT_EXPECT_EQ(test,
+			  sbi_timer_event_add(&test_events[1], now - 2), 0);
+	SBIUNIT_EXPECT_EQ(test,
+			  sbi_timer_event_add(&test_events[2], now - 1), 0);
+	SBIUNIT_EXPECT_EQ(test,
+			  sbi_timer_event_add(&test_events[3], -1ULL), 0);
+
+	sbi_timer_process();
+
+	SBIUNIT_EXPECT_EQ(test, test_fired, 3);
+	SBIUNIT_EXPECT_EQ(test, test_order[0], 1);
+	SBIUNIT_EXPECT_EQ(test, test_order[1], 2);
+	SBIUNIT_EXPECT_EQ(test, test_order[2], 0);
+	SBIUNIT_EXPECT(test, !sbi_timer_event_pending(&test_events[0]));
+	SBIUNIT_EXPECT(test, sbi_timer_event_pending(&test_events[3]));
+
+	sbi_timer_event_cancel(&test_events[3]);
+	SBIUNIT_EXPECT(test, !sbi_timer_event_pending(&test_events[3]));
+}
+
+static void timer_event_modify_test(struct sbiunit_test_case *test)
+{
+	u64 now = sbi_timer_value();
+
+	timer_test_reset();
+
+	/* Queueing an event again moves it instead of adding it twice */
+	sbi_timer_event_add(&test_events[0], -1ULL);
+	sbi_timer_event_add(&test_events[1], now - 1);
+	sbi_timer_event_add(&test_events[0], now - 2);
+	sbi_timer_event_cancel(&test_events[1]);
+
+	sbi_timer_process();
+
+	SBIUNIT_EXPECT_EQ(test, test_fired, 1);
+	SBIUNIT_EXPECT_EQ(test, test_order[0], 0);
+
+	SBIUNIT_EXPECT_EQ(test, sbi_timer_event_add(NULL, now), SBI_EINVAL);
+	test_events[2].callback = NULL;
+	SBIUNIT_EXPECT_EQ(test, sbi_timer_event_add(&test_events[2], now),
+			  SBI_EINVAL);
+}
+
+static struct sbiunit_test_case timer_test_cases[] = {
+	SBIUNIT_TEST_CASE(timer_event_order_test),
+	SBIUNIT_TEST_CASE(timer_event_modify_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(timer_test_suite, timer_test_cases);
@@ -0,0 +1,255 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2026 RevyOS Team.
+ */
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_scratch.h>
+#include <sbi/sbi_string.h>
+#include <sbi/sbi_trap.h>
+#include <sbi/sbi_unit_test.h>
+#include <sbi/sbi_unpriv.h>
+
+#define UNPRIV_TEST_BYTES	64
+
+/* PMP entry and NAPOT block used to give S-mode access to firmware memory */
+#define UNPRIV_TEST_PMP		1
+#define UNPRIV_TEST_BLOCK_SHIFT	12
+#define UNPRIV_TEST_BLOCK	(1UL << UNPRIV_TEST_BLOCK_SHIFT)
+
+static u8 unpriv_buf[UNPRIV_TEST_BYTES] __aligned(sizeof(ulong));
+static u8 unpriv_ref[UNPRIV_TEST_BYTES] __aligned(sizeof(ulong));
+static u8 unpriv_out[UNPRIV_TEST_BYTES] __aligned(sizeof(ulong));
+static u8 unpriv_block[2 * UNPRIV_TEST_BLOCK] __aligned(UNPRIV_TEST_BLOCK);
+
+struct unpriv_test_ctx {
+	ulong mstatus;
+	ulong satp;
+	ulong pmpcfg;
+	ulong pmpaddr;
+};
+
+/*
+ * Run the unprivileged accessors against firmware memory by making MPRV
+ * accesses use M-mode (MPP = M) for the duration of a test.
+ */
+static ulong unpriv_test_begin(void)
+{
+	ulong mstatus = csr_read(CSR_MSTATUS);
+
+	csr_set(CSR_MSTATUS, MSTATUS_MPP);
+	return mstatus;
+}
+
+static void unpriv_test_end(ulong mstatus)
+{
+	csr_write(CSR_MSTATUS, mstatus);
+}
+
+/*
+ * Make MPRV accesses use S-mode (MPP = S, bare translation) and give S-mode
+ * the pmp_flags access to the first block of unpriv_block through PMP
+ * entry 1.
+ * The second block matches no PMP entry, so S-mode accesses to it fault.
+ * The tests run before the domain PMP configuration. Entry 0 is left
+ * alone since Smepmp shared memory mappings use it. The configuration of
+ * entry 1 is byte 1 of pmpcfg0 on both RV32 and RV64.
+ */
+static bool unpriv_user_begin(struct unpriv_test_ctx *ctx, ulong pmp_flags)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+
+	if (!misa_extension('S') ||
+	    sbi_hart_pmp_count(scratch) <= UNPRIV_TEST_PMP ||
+	    sbi_hart_pmp_log2gran(scratch) > UNPRIV_TEST_BLOCK_SHIFT)
+		return false;
+
+	ctx->pmpcfg = csr_read(CSR_PMPCFG0);
+	if ((ctx->pmpcfg >> (UNPRIV_TEST_PMP * 8)) & PMP_L)
+		return false;
+	ctx->pmpaddr = csr_read(CSR_PMPADDR1);
+
+	pmp_set(UNPRIV_TEST_PMP, pmp_flags, (ulong)unpriv_block,
+		UNPRIV_TEST_BLOCK_SHIFT);
+	sbi_hart_pmp_fence();
+
+	ctx->satp = csr_swap(CSR_SATP, 0);
+	ctx->mstatus = csr_read(CSR_MSTATUS);
+	csr_clear(CSR_MSTATUS, MSTATUS_MPP);
+	csr_set(CSR_MSTATUS, PRV_S << MSTATUS_MPP_SHIFT);
+
+	return true;
+}
+
+static void unpriv_user_end(struct unpriv_test_ctx *ctx)
+{
+	ulong mask = 0xffUL << (UNPRIV_TEST_PMP * 8);
+
+	csr_write(CSR_MSTATUS, ctx->mstatus);
+	csr_write(CSR_SATP, ctx->satp);
+
+	csr_write(CSR_PMPADDR1, ctx->pmpaddr);
+	csr_write(CSR_PMPCFG0, (csr_read(CSR_PMPCFG0) & ~mask) |
+			       (ctx->pmpcfg & mask));
+	sbi_hart_pmp_fence();
+}
+
+static void unpriv_test_fill(u8 *buf, u32 seed)
+{
+	u32 i;
+
+	for (i = 0; i < UNPRIV_TEST_BYTES; i++)
+		buf[i] = seed + 0x11 * (i + 1);
+}
+
+static void unpriv_copy_from_user_test(struct sbiunit_test_case *test)
+{
+	struct sbi_trap_info trap;
+	ulong mstatus, done;
+	u32 soff, doff, len;
+	bool ok = true;
+
+	unpriv_test_fill(unpriv_buf, 0);
+
+	for (soff = 0; soff < sizeof(ulong); soff++) {
+		for (doff = 0; doff < sizeof(ulong); doff++) {
+			for (len = 0; len <= 3 * sizeof(ulong) + 1; len++) {
+				unpriv_test_fill(unpriv_out, 7);
+				sbi_memcpy(unpriv_ref, unpriv_out,
+					   sizeof(unpriv_ref));
+				sbi_memcpy(unpriv_ref + doff, unpriv_buf + soff,
+					   len);
+
+				mstatus = unpriv_test_begin();
+				done = sbi_copy_from_user(unpriv_out + doff,
+							  unpriv_buf + soff,
+							  len, &trap);
+				unpriv_test_end(mstatus);
+
+				ok &= !trap.cause && done == len;
+				ok &= !sbi_memcmp(unpriv_out, unpriv_ref,
+						  sizeof(unpriv_out));
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+static void unpriv_copy_to_user_test(struct sbiunit_test_case *test)
+{
+	struct sbi_trap_info trap;
+	ulong mstatus, done;
+	u32 soff, doff, len;
+	bool ok = true;
+
+	unpriv_test_fill(unpriv_out, 0);
+
+	for (soff = 0; soff < sizeof(ulong); soff++) {
+		for (doff = 0; doff < sizeof(ulong); doff++) {
+			for (len = 0; len <= 3 * sizeof(ulong) + 1; len++) {
+				/* Neighbouring bytes must stay untouched */
+				unpriv_test_fill(unpriv_buf, 7);
+				sbi_memcpy(unpriv_ref, unpriv_buf,
+					   sizeof(unpriv_ref));
+				sbi_memcpy(unpriv_ref + doff, unpriv_out + soff,
+					   len);
+
+				mstatus = unpriv_test_begin();
+				done = sbi_copy_to_user(unpriv_buf + doff,
+							unpriv_out + soff,
+							len, &trap);
+				unpriv_test_end(mstatus);
+
+				ok &= !trap.cause && done == len;
+				ok &= !sbi_memcmp(unpriv_buf, unpriv_ref,
+						  sizeof(unpriv_buf));
+			}
+		}
+	}
+
+	SBIUNIT_EXPECT(test, ok);
+}
+
+/*
+ * Copies running from the accessible block into the faulting one must
+ * report the bytes copied before the fault and the faulting address.
+ */
+static void unpriv_copy_fault_test(struct sbiunit_test_case *test)
+{
+	u8 *edge = unpriv_block + UNPRIV_TEST_BLOCK;
+	struct sbi_trap_info ltrap, wtrap, strap;
+	ulong ldone, wdone, sdone;
+	struct unpriv_test_ctx ctx;
+
+	unpriv_test_fill(edge - UNPRIV_TEST_BYTES, 3);
+	unpriv_test_fill(edge, 5);
+	unpriv_test_fill(unpriv_buf, 9);
+	sbi_memcpy(unpriv_ref, edge, sizeof(unpriv_ref));
+	sbi_memset(unpriv_out, 0, sizeof(unpriv_out));
+
+	/* Nothing to test without S-mode or a usable PMP entry */
+	if (!unpriv_user_begin(&ctx, PMP_R | PMP_W))
+		return;
+
+	/* Misaligned and aligned loads, then a misaligned store */
+	ldone = sbi_copy_from_user(unpriv_out, edge - 5, 16, &ltrap);
+	wdone = sbi_copy_from_user(unpriv_out + 16, edge - 16, 24, &wtrap);
+	sdone = sbi_copy_to_user(edge - 3, unpriv_buf, 11, &strap);
+
+	unpriv_user_end(&ctx);
+
+	SBIUNIT_EXPECT_EQ(test, ldone, 5);
+	SBIUNIT_EXPECT_EQ(test, ltrap.cause, CAUSE_LOAD_ACCESS);
+	SBIUNIT_EXPECT_EQ(test, ltrap.tval, (ulong)edge);
+	SBIUNIT_EXPECT_MEMEQ(test, unpriv_out, edge - 5, 5);
+
+	SBIUNIT_EXPECT_EQ(test, wdone, 16);
+	SBIUNIT_EXPECT_EQ(test, wtrap.cause, CAUSE_LOAD_ACCESS);
+	SBIUNIT_EXPECT_EQ(test, wtrap.tval, (ulong)edge);
+	SBIUNIT_EXPECT_MEMEQ(test, unpriv_out + 16, edge - 16, 16);
+
+	SBIUNIT_EXPECT_EQ(test, sdone, 3);
+	SBIUNIT_EXPECT_EQ(test, strap.cause, CAUSE_STORE_ACCESS);
+	SBIUNIT_EXPECT_EQ(test, strap.tval, (ulong)edge);
+	SBIUNIT_EXPECT_MEMEQ(test, edge - 3, unpriv_buf, 3);
+	SBIUNIT_EXPECT_MEMEQ(test, edge, unpriv_ref, sizeof(unpriv_ref));
+}
+
+/*
+ * A shared memory mapping which stays programmed after being unmapped must
+ * not let S-mode write the same block through MPRV.
+ */
+static void unpriv_saddr_store_test(struct sbiunit_test_case *test)
+{
+	struct sbi_trap_info trap;
+	struct unpriv_test_ctx ctx;
+
+	unpriv_block[0] = 0xa5;
+
+	/* S-mode may only read the first block */
+	if (!unpriv_user_begin(&ctx, PMP_R))
+		return;
+
+	if (!sbi_hart_map_saddr((ulong)unpriv_block, UNPRIV_TEST_BYTES))
+		sbi_hart_unmap_saddr();
+	sbi_store_u8(unpriv_block, 0x5a, &trap);
+
+	unpriv_user_end(&ctx);
+
+	SBIUNIT_EXPECT_EQ(test, trap.cause, CAUSE_STORE_ACCESS);
+	SBIUNIT_EXPECT_EQ(test, trap.tval, (ulong)unpriv_block);
+	SBIUNIT_EXPECT_EQ(test, unpriv_block[0], 0xa5);
+}
+
+static struct sbiunit_test_case unpriv_test_cases[] = {
+	SBIUNIT_TEST_CASE(unpriv_copy_from_user_test),
+	SBIUNIT_TEST_CASE(unpriv_copy_to_user_test),
+	SBIUNIT_TEST_CASE(unpriv_copy_fault_test),
+	SBIUNIT_TEST_CASE(unpriv_saddr_store_test),
+	SBIUNIT_END_CASE,
+};
+
+SBIUNIT_TEST_SUITE(unpriv_test_suite, unpriv_test_cases);
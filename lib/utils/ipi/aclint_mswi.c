@@ -12,63 +12,68 @@
 #include <sbi/riscv_io.h>
 #include <sbi/sbi_domain.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_timer.h>
 #include <sbi_utils/ipi/aclint_mswi.h>
 
-static unsigned long mswi_ptr_offset;
+/* Scratch offset of the MSIP register pointer of each HART */
+static unsigned long mswi_msip_offset;
 
-#define mswi_get_hart_data_ptr(__scratch)				\
-	sbi_scratch_read_type((__scratch), void *, mswi_ptr_offset)
+#define mswi_get_hart_msip(__scratch)					\
+	sbi_scratch_read_type((__scratch), u32 *, mswi_msip_offset)
 
-#define mswi_set_hart_data_ptr(__scratch, __mswi)			\
-	sbi_scratch_write_type((__scratch), void *, mswi_ptr_offset, (__mswi))
+#define mswi_set_hart_msip(__scratch, __msip)				\
+	sbi_scratch_write_type((__scratch), u32 *, mswi_msip_offset, (__msip))
 
-static void mswi_ipi_send(u32 hart_index)
+static inline u32 *mswi_hartindex_msip(u32 hart_index)
 {
-	u32 *msip;
-	struct sbi_scratch *scratch;
-	struct aclint_mswi_data *mswi;
+	struct sbi_scratch *scratch = sbi_hartindex_to_scratch(hart_index);
 
-	scratch = sbi_hartindex_to_scratch(hart_index);
-	if (!scratch)
-		return;
+	return scratch ? mswi_get_hart_msip(scratch) : NULL;
+}
 
-	mswi = mswi_get_hart_data_ptr(scratch);
-	if (!mswi)
-		return;
+static void mswi_ipi_send(u32 hart_index)
+{
+	u32 *msip = mswi_hartindex_msip(hart_index);
 
 	/* Set ACLINT IPI */
-	msip = (void *)mswi->addr;
-	writel_relaxed(1, &msip[sbi_hartindex_to_hartid(hart_index) -
-			mswi->first_hartid]);
+	if (msip)
+		writel_relaxed(1, msip);
 }
 
-static void mswi_ipi_clear(void)
+static void mswi_ipi_send_mask(const struct sbi_hartmask *mask)
 {
-	u32 *msip;
-	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
-	struct aclint_mswi_data *mswi;
+	u32 i, *msip;
 
-	mswi = mswi_get_hart_data_ptr(scratch);
-	if (!mswi)
-		return;
+	/* Set ACLINT IPI of all target HARTs back to back */
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		msip = mswi_hartindex_msip(i);
+		if (msip)
+			writel_relaxed(1, msip);
+	}
+}
+
+static void mswi_ipi_clear(void)
+{
+	u32 *msip = mswi_get_hart_msip(sbi_scratch_thishart_ptr());
 
 	/* Clear ACLINT IPI */
-	msip = (void *)mswi->addr;
-	writel_relaxed(0, &msip[current_hartid() - mswi->first_hartid]);
+	if (msip)
+		writel_relaxed(0, msip);
 }
 
 static struct sbi_ipi_device aclint_mswi = {
 	.name = "aclint-mswi",
 	.ipi_send = mswi_ipi_send,
+	.ipi_send_mask = mswi_ipi_send_mask,
 	.ipi_clear = mswi_ipi_clear
 };
 
 int aclint_mswi_cold_init(struct aclint_mswi_data *mswi)
 {
-	u32 i;
+	u32 i, *msip;
 	int rc;
 	struct sbi_scratch *scratch;
 
@@ -79,13 +84,14 @@ int aclint_mswi_cold_init(struct aclint_mswi_data *mswi)
 		return SBI_EINVAL;
 
 	/* Allocate scratch space pointer */
-	if (!mswi_ptr_offset) {
-		mswi_ptr_offset = sbi_scratch_alloc_type_offset(void *);
-		if (!mswi_ptr_offset)
+	if (!mswi_msip_offset) {
+		mswi_msip_offset = sbi_scratch_alloc_type_offset(u32 *);
+		if (!mswi_msip_offset)
 			return SBI_ENOMEM;
 	}
 
-	/* Update MSWI pointer in scratch space */
+	/* Update MSIP register pointer in scratch space */
+	msip = (void *)mswi->addr;
 	for (i = 0; i < mswi->hart_count; i++) {
 		scratch = sbi_hartid_to_scratch(mswi->first_hartid + i);
 		/*
@@ -95,7 +101,7 @@ int aclint_mswi_cold_init(struct aclint_mswi_data *mswi)
 		 */
 		if (!scratch)
 			continue;
-		mswi_set_hart_data_ptr(scratch, mswi);
+		mswi_set_hart_msip(scratch, &msip[i]);
 	}
 
 	/* Add MSWI regions to the root domain */
@@ -13,6 +13,7 @@
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_io.h>
 #include <sbi/sbi_domain.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi_utils/ipi/andes_plicsw.h>
 
@@ -41,6 +42,42 @@ static void plicsw_ipi_send(u32 hart_index)
 	writel_relaxed(BIT(pending_bit), (void *)pending_reg);
 }
 
+static void plicsw_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i, interrupt_id, word_index, pending_word = -1U;
+	u32 pending_bits = 0, target_hart;
+
+	/*
+	 * Pending bits of the target harts sharing a pending register
+	 * are combined into a single write. Hart indices are visited
+	 * in increasing order and hart IDs usually follow the same
+	 * order, so most masks need one write per 32 harts.
+	 */
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		target_hart = sbi_hartindex_to_hartid(i);
+		if (plicsw.hart_count <= target_hart)
+			ebreak();
+
+		interrupt_id = target_hart + 1;
+		word_index   = interrupt_id / 32;
+		if (word_index != pending_word) {
+			if (pending_bits)
+				writel_relaxed(pending_bits,
+					       (void *)(plicsw.addr +
+					       PLICSW_PENDING_BASE +
+					       pending_word * 4));
+			pending_word = word_index;
+			pending_bits = 0;
+		}
+		pending_bits |= BIT(interrupt_id % 32);
+	}
+
+	if (pending_bits)
+		writel_relaxed(pending_bits,
+			       (void *)(plicsw.addr + PLICSW_PENDING_BASE +
+			       pending_word * 4));
+}
+
 static void plicsw_ipi_clear(void)
 {
 	u32 target_hart = current_hartid();
@@ -62,6 +99,7 @@ static void plicsw_ipi_clear(void)
 static struct sbi_ipi_device plicsw_ipi = {
 	.name      = "andes_plicsw",
 	.ipi_send  = plicsw_ipi_send,
+	.ipi_send_mask = plicsw_ipi_send_mask,
 	.ipi_clear = plicsw_ipi_clear
 };
 
@@ -14,6 +14,7 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_csr_detect.h>
 #include <sbi/sbi_domain.h>
+#include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_ipi.h>
 #include <sbi/sbi_irqchip.h>
 #include <sbi/sbi_error.h>
@@ -96,6 +97,32 @@ static unsigned long imsic_file_offset;
 #define imsic_set_hart_file(__scratch, __file)				\
 	sbi_scratch_write_type((__scratch), long, imsic_file_offset, (__file))
 
+static unsigned long imsic_ipi_offset;
+
+#define imsic_get_hart_ipi_addr(__scratch)				\
+	sbi_scratch_read_type((__scratch), void *, imsic_ipi_offset)
+
+#define imsic_set_hart_ipi_addr(__scratch, __addr)			\
+	sbi_scratch_write_type((__scratch), void *, imsic_ipi_offset, (__addr))
+
+/* Find the little-endian SETEIPNUM register of an interrupt file */
+static void *imsic_file_ipi_addr(struct imsic_data *imsic, int file)
+{
+	unsigned long reloff;
+	struct imsic_regs *regs = &imsic->regs[0];
+
+	reloff = file * (1UL << imsic->guest_index_bits) * IMSIC_MMIO_PAGE_SZ;
+	while (regs->size && (regs->size <= reloff)) {
+		reloff -= regs->size;
+		regs++;
+	}
+
+	if (regs->size && (reloff < regs->size))
+		return (void *)(regs->addr + reloff + IMSIC_MMIO_PAGE_LE);
+
+	return NULL;
+}
+
 int imsic_map_hartid_to_data(u32 hartid, struct imsic_data *imsic, int file)
 {
 	struct sbi_scratch *scratch;
@@ -116,6 +143,7 @@ int imsic_map_hartid_to_data(u32 hartid, struct imsic_data *imsic, int file)
 
 	imsic_set_hart_data_ptr(scratch, imsic);
 	imsic_set_hart_file(scratch, file);
+	imsic_set_hart_ipi_addr(scratch, imsic_file_ipi_addr(imsic, file));
 	return 0;
 }
 
@@ -168,38 +196,38 @@ static int imsic_external_irqfn(void)
 	return 0;
 }
 
-static void imsic_ipi_send(u32 hart_index)
+static inline void *imsic_hartindex_ipi_addr(u32 hart_index)
 {
-	unsigned long reloff;
-	struct imsic_regs *regs;
-	struct imsic_data *data;
-	struct sbi_scratch *scratch;
-	int file;
+	struct sbi_scratch *scratch = sbi_hartindex_to_scratch(hart_index);
 
-	scratch = sbi_hartindex_to_scratch(hart_index);
-	if (!scratch)
-		return;
+	return scratch ? imsic_get_hart_ipi_addr(scratch) : NULL;
+}
 
-	data = imsic_get_hart_data_ptr(scratch);
-	file = imsic_get_hart_file(scratch);
-	if (!data || !data->targets_mmode)
-		return;
+static void imsic_ipi_send(u32 hart_index)
+{
+	void *addr = imsic_hartindex_ipi_addr(hart_index);
 
-	regs = &data->regs[0];
-	reloff = file * (1UL << data->guest_index_bits) * IMSIC_MMIO_PAGE_SZ;
-	while (regs->size && (regs->size <= reloff)) {
-		reloff -= regs->size;
-		regs++;
-	}
+	if (addr)
+		writel_relaxed(IMSIC_IPI_ID, addr);
+}
 
-	if (regs->size && (reloff < regs->size))
-		writel_relaxed(IMSIC_IPI_ID,
-			(void *)(regs->addr + reloff + IMSIC_MMIO_PAGE_LE));
+static void imsic_ipi_send_mask(const struct sbi_hartmask *mask)
+{
+	u32 i;
+	void *addr;
+
+	/* Write the MSIs of all target HARTs back to back */
+	sbi_hartmask_for_each_hartindex(i, mask) {
+		addr = imsic_hartindex_ipi_addr(i);
+		if (addr)
+			writel_relaxed(IMSIC_IPI_ID, addr);
+	}
 }
 
 static struct sbi_ipi_device imsic_ipi_device = {
 	.name		= "aia-imsic",
-	.ipi_send	= imsic_ipi_send
+	.ipi_send	= imsic_ipi_send,
+	.ipi_send_mask	= imsic_ipi_send_mask
 };
 
 static void imsic_local_eix_update(unsigned long base_id,
@@ -377,6 +405,13 @@ int imsic_cold_irqchip_init(struct imsic_data *imsic)
 			return SBI_ENOMEM;
 	}
 
+	/* Allocate scratch space IPI address */
+	if (!imsic_ipi_offset) {
+		imsic_ipi_offset = sbi_scratch_alloc_type_offset(void *);
+		if (!imsic_ipi_offset)
+			return SBI_ENOMEM;
+	}
+
 	/* Add IMSIC regions to the root domain */
 	for (i = 0; i < IMSIC_MAX_REGS && imsic->regs[i].size; i++) {
 		rc = sbi_domain_root_add_memrange(imsic->regs[i].addr,
@@ -34,8 +34,11 @@
 #define UART_BRGR_CD_CLKDIVISOR	0x00000001	/* baud_sample = sel_clk */
 
 #define	UART_CSR_REMPTY		0x00000002
+#define	UART_CSR_TEMPTY		0x00000008
 #define	UART_CSR_TFUL		0x00000010
 
+#define UART_TXFIFO_DEPTH	64
+
 /* clang-format on */
 
 static volatile void *uart_base;
@@ -76,6 +79,36 @@ static void cadence_uart_putc(char ch)
 	set_reg(UART_REG_RFIFO_TFIFO, ch);
 }
 
+/* Set when the '\r' in front of a '\n' went out but the '\n' did not */
+static bool cadence_uart_cr_sent;
+
+/*
+ * A single status read showing an empty transmit FIFO allows a burst of
+ * a full FIFO. Returns 0 without waiting if the transmitter is still
+ * busy.
+ */
+static unsigned long cadence_uart_puts(const char *str, unsigned long len)
+{
+	unsigned long i = 0;
+	u32 room;
+
+	if (!(get_reg(UART_REG_CSR) & UART_CSR_TEMPTY))
+		return 0;
+
+	for (room = UART_TXFIFO_DEPTH; room && i < len; room--) {
+		if (str[i] == '\n' && !cadence_uart_cr_sent) {
+			set_reg(UART_REG_RFIFO_TFIFO, '\r');
+			cadence_uart_cr_sent = true;
+			continue;
+		}
+
+		set_reg(UART_REG_RFIFO_TFIFO, str[i++]);
+		cadence_uart_cr_sent = false;
+	}
+
+	return i;
+}
+
 static int cadence_uart_getc(void)
 {
 	u32 ret = get_reg(UART_REG_CSR);
@@ -89,6 +122,7 @@ static int cadence_uart_getc(void)
 static struct sbi_console_device cadence_console = {
 	.name = "cadence_uart",
 	.console_putc = cadence_uart_putc,
+	.console_puts = cadence_uart_puts,
 	.console_getc = cadence_uart_getc
 };
 
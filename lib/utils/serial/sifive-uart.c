@@ -74,6 +74,32 @@ static void sifive_uart_putc(char ch)
 	set_reg(UART_REG_TXFIFO, ch);
 }
 
+/* Set when the '\r' in front of a '\n' went out but the '\n' did not */
+static bool sifive_uart_cr_sent;
+
+/*
+ * Write characters until the transmit FIFO reports full. The full bit of
+ * txdata is checked before every character since S-mode may reprogram the
+ * transmit watermark. Returns 0 without waiting if the FIFO is full.
+ */
+static unsigned long sifive_uart_puts(const char *str, unsigned long len)
+{
+	unsigned long i = 0;
+
+	while (i < len && !(get_reg(UART_REG_TXFIFO) & UART_TXFIFO_FULL)) {
+		if (str[i] == '\n' && !sifive_uart_cr_sent) {
+			set_reg(UART_REG_TXFIFO, '\r');
+			sifive_uart_cr_sent = true;
+			continue;
+		}
+
+		set_reg(UART_REG_TXFIFO, str[i++]);
+		sifive_uart_cr_sent = false;
+	}
+
+	return i;
+}
+
 static int sifive_uart_getc(void)
 {
 	u32 ret = get_reg(UART_REG_RXFIFO);
@@ -87,6 +113,7 @@ static int sifive_uart_getc(void)
 static struct sbi_console_device sifive_console = {
 	.name = "sifive_uart",
 	.console_putc = sifive_uart_putc,
+	.console_puts = sifive_uart_puts,
 	.console_getc = sifive_uart_getc
 };
 
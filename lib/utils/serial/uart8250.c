@@ -39,6 +39,10 @@
 #define UART_LSR_DR		0x01	/* Receiver data ready */
 #define UART_LSR_BRK_ERROR_BITS	0x1E	/* BI, FE, PE, OE bits */
 
+#define UART_IIR_FIFO_ENABLED	0xC0	/* FIFOs enabled (16550A and later) */
+
+#define UART_FIFO_DEPTH		16	/* Smallest 16550 compatible FIFO */
+
 /* clang-format on */
 
 static volatile char *uart8250_base;
@@ -46,6 +50,7 @@ static u32 uart8250_in_freq;
 static u32 uart8250_baudrate;
 static u32 uart8250_reg_width;
 static u32 uart8250_reg_shift;
+static u32 uart8250_tx_fifo = 1;
 
 static u32 get_reg(u32 num)
 {
@@ -79,6 +84,36 @@ static void uart8250_putc(char ch)
 	set_reg(UART_THR_OFFSET, ch);
 }
 
+/* Set when the '\r' in front of a '\n' went out but the '\n' did not */
+static bool uart8250_cr_sent;
+
+/*
+ * THRE is set once the whole transmit FIFO is empty, so a single status
+ * read allows a burst of a full FIFO. Returns 0 without waiting if the
+ * transmitter is still busy.
+ */
+static unsigned long uart8250_puts(const char *str, unsigned long len)
+{
+	unsigned long i = 0;
+	u32 room;
+
+	if (!(get_reg(UART_LSR_OFFSET) & UART_LSR_THRE))
+		return 0;
+
+	for (room = uart8250_tx_fifo; room && i < len; room--) {
+		if (str[i] == '\n' && !uart8250_cr_sent) {
+			set_reg(UART_THR_OFFSET, '\r');
+			uart8250_cr_sent = true;
+			continue;
+		}
+
+		set_reg(UART_THR_OFFSET, str[i++]);
+		uart8250_cr_sent = false;
+	}
+
+	return i;
+}
+
 static int uart8250_getc(void)
 {
 	if (get_reg(UART_LSR_OFFSET) & UART_LSR_DR)
@@ -89,6 +124,7 @@ static int uart8250_getc(void)
 static struct sbi_console_device uart8250_console = {
 	.name = "uart8250",
 	.console_putc = uart8250_putc,
+	.console_puts = uart8250_puts,
 	.console_getc = uart8250_getc
 };
 
@@ -124,6 +160,12 @@ int uart8250_init(unsigned long base, u32 in_freq, u32 baudrate, u32 reg_shift,
 	set_reg(UART_LCR_OFFSET, 0x03);
 	/* Enable FIFO */
 	set_reg(UART_FCR_OFFSET, 0x01);
+	/* Plain 8250 and 16450 have no FIFO */
+	if ((get_reg(UART_IIR_OFFSET) & UART_IIR_FIFO_ENABLED) ==
+	    UART_IIR_FIFO_ENABLED)
+		uart8250_tx_fifo = UART_FIFO_DEPTH;
+	else
+		uart8250_tx_fifo = 1;
 	/* No modem control DTR RTS */
 	set_reg(UART_MCR_OFFSET, 0x00);
 	/* Clear line status */
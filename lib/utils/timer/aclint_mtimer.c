@@ -82,10 +82,7 @@ static void mtimer_event_stop(void)
 		return;
 
 	/* Clear MTIMER Time Compare */
-	if (sbi_hart_has_extension(scratch, SBI_HART_EXT_XTHEADSSTC))
-		time_cmp = (void *)(mt->mtimecmp_addr + 0x9000);
-	else
-		time_cmp = (void *)mt->mtimecmp_addr;
+	time_cmp = (void *)mt->mtimecmp_addr;
 	mt->time_wr(true, -1ULL, &time_cmp[target_hart - mt->first_hartid]);
 }
 
@@ -101,10 +98,24 @@ static void mtimer_event_start(u64 next_event)
 		return;
 
 	/* Program MTIMER Time Compare */
-	if (sbi_hart_has_extension(scratch, SBI_HART_EXT_XTHEADSSTC))
-		time_cmp = (void *)(mt->mtimecmp_addr + 0x9000);
-	else
-		time_cmp = (void *)mt->mtimecmp_addr;
+	time_cmp = (void *)mt->mtimecmp_addr;
+	mt->time_wr(true, next_event,
+		    &time_cmp[target_hart - mt->first_hartid]);
+}
+
+static void mtimer_s_event_start(u64 next_event)
+{
+	u32 target_hart = current_hartid();
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	struct aclint_mtimer_data *mt;
+	u64 *time_cmp;
+
+	mt = mtimer_get_hart_data_ptr(scratch);
+	if (!mt || !mt->stimecmp_addr)
+		return;
+
+	/* Program supervisor Time Compare */
+	time_cmp = (void *)mt->stimecmp_addr;
 	mt->time_wr(true, next_event,
 		    &time_cmp[target_hart - mt->first_hartid]);
 }
@@ -113,7 +124,8 @@ static struct sbi_timer_device mtimer = {
 	.name = "aclint-mtimer",
 	.timer_value = mtimer_value,
 	.timer_event_start = mtimer_event_start,
-	.timer_event_stop = mtimer_event_stop
+	.timer_event_stop = mtimer_event_stop,
+	.timer_s_event_start = mtimer_s_event_start
 };
 
 void aclint_mtimer_sync(struct aclint_mtimer_data *mt)
@@ -169,6 +181,12 @@ static int aclint_mtimer_warm_init(void)
 	mt->time_wr(true, -1ULL,
 		    &mt_time_cmp[target_hart - mt->first_hartid]);
 
+	if (mt->stimecmp_addr) {
+		mt_time_cmp = (void *)mt->stimecmp_addr;
+		mt->time_wr(true, -1ULL,
+			    &mt_time_cmp[target_hart - mt->first_hartid]);
+	}
+
 	return 0;
 }
 
@@ -266,6 +284,24 @@ int aclint_mtimer_cold_init(struct aclint_mtimer_data *mt,
 			return rc;
 	}
 
+	/*
+	 * Let S-mode program the T-Head supervisor compare registers
+	 * itself so that it does not need SBI set_timer calls.
+	 */
+	if (mt->hart_count &&
+	    sbi_hart_has_extension(sbi_scratch_thishart_ptr(),
+				   SBI_HART_EXT_XTHEADSSTC)) {
+		mt->stimecmp_addr = mt->mtimecmp_addr + THEAD_STIMECMP_OFFSET;
+		rc = sbi_domain_root_add_memrange(mt->stimecmp_addr,
+					ROUNDUP(mt->hart_count * sizeof(u64),
+						MTIMER_REGION_ALIGN),
+					MTIMER_REGION_ALIGN,
+					(SBI_DOMAIN_MEMREGION_MMIO |
+					 SBI_DOMAIN_MEMREGION_SHARED_SURW_MRW));
+		if (rc)
+			return rc;
+	}
+
 	mtimer.timer_freq = mt->mtime_freq;
 	mtimer.warm_init = aclint_mtimer_warm_init;
 	sbi_timer_set_device(&mtimer);
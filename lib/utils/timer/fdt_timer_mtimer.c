@@ -8,9 +8,12 @@
  */
 
 #include <libfdt.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_console.h>
 #include <sbi/sbi_error.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_list.h>
+#include <sbi_utils/fdt/fdt_fixup.h>
 #include <sbi_utils/fdt/fdt_helper.h>
 #include <sbi_utils/timer/fdt_timer.h>
 #include <sbi_utils/timer/aclint_mtimer.h>
@@ -30,6 +33,137 @@ static SBI_LIST_HEAD(mtn_list);
 
 static struct aclint_mtimer_data *mt_reference = NULL;
 
+/* Append the supervisor timer interrupt of a HART to interrupts-extended */
+static int timer_mtimer_stimer_add_irq(void *fdt, int nodeoff, u32 hartid)
+{
+	int cpus_off, cpu_off, intc_off, err;
+	u32 cpu_hartid, phandle;
+
+	cpus_off = fdt_path_offset(fdt, "/cpus");
+	if (cpus_off < 0)
+		return cpus_off;
+
+	fdt_for_each_subnode(cpu_off, fdt, cpus_off) {
+		if (fdt_parse_hart_id(fdt, cpu_off, &cpu_hartid) ||
+		    cpu_hartid != hartid)
+			continue;
+
+		intc_off = fdt_subnode_offset(fdt, cpu_off,
+					      "interrupt-controller");
+		if (intc_off < 0)
+			return 0;
+		phandle = fdt_get_phandle(fdt, intc_off);
+		if (!phandle)
+			return 0;
+
+		err = fdt_appendprop_cell(fdt, nodeoff, "interrupts-extended",
+					  phandle);
+		if (err < 0)
+			return err;
+		return fdt_appendprop_cell(fdt, nodeoff, "interrupts-extended",
+					   IRQ_S_TIMER);
+	}
+
+	return 0;
+}
+
+/*
+ * Describe the supervisor compare registers handed to S-mode so that the
+ * OS can program them directly instead of calling SBI set_timer. See
+ * docs/platform/thead-c9xx.md for the binding. A partially written node
+ * is removed again on failure.
+ */
+static int timer_mtimer_stimer_add_node(void *fdt, int parent,
+					const struct aclint_mtimer_data *mt)
+{
+	int na = fdt_address_cells(fdt, parent);
+	int ns = fdt_size_cells(fdt, parent);
+	u64 addr = mt->stimecmp_addr;
+	u64 size = ROUNDUP(mt->hart_count * sizeof(u64), MTIMER_REGION_ALIGN);
+	fdt32_t reg[4], *val = reg;
+	char name[32];
+	int nodeoff, err;
+	u32 i;
+
+	sbi_snprintf(name, sizeof(name), "timer@%lx", mt->stimecmp_addr);
+	if (fdt_subnode_offset(fdt, parent, name) >= 0)
+		return 0;
+
+	nodeoff = fdt_add_subnode(fdt, parent, name);
+	if (nodeoff < 0)
+		return nodeoff;
+
+	err = fdt_setprop_string(fdt, nodeoff, "compatible",
+				 "opensbi,thead-c900-stimer");
+	if (err < 0)
+		goto fail;
+
+	if (na > 1)
+		*val++ = cpu_to_fdt32(addr >> 32);
+	*val++ = cpu_to_fdt32(addr);
+	if (ns > 1)
+		*val++ = cpu_to_fdt32(size >> 32);
+	*val++ = cpu_to_fdt32(size);
+	err = fdt_setprop(fdt, nodeoff, "reg", reg,
+			  (na + ns) * sizeof(fdt32_t));
+	if (err < 0)
+		goto fail;
+
+	for (i = 0; i < mt->hart_count; i++) {
+		err = timer_mtimer_stimer_add_irq(fdt, nodeoff,
+						  mt->first_hartid + i);
+		if (err < 0)
+			goto fail;
+	}
+
+	return 0;
+
+fail:
+	fdt_del_node(fdt, nodeoff);
+	return err;
+}
+
+static void timer_mtimer_stimer_fixup(struct fdt_general_fixup *f,
+				      void *fdt)
+{
+	struct timer_mtimer_node *mtn;
+	int parent, err, size = 0;
+
+	/* Room for the node name, compatible, reg and two cells per HART */
+	sbi_list_for_each_entry(mtn, &mtn_list, head) {
+		if (mtn->data.stimecmp_addr)
+			size += 256 + 8 * mtn->data.hart_count;
+	}
+	if (!size)
+		return;
+
+	err = fdt_open_into(fdt, fdt, fdt_totalsize(fdt) + size);
+	if (err < 0) {
+		sbi_printf("%s: failed to expand FDT (error %d)\n",
+			   f->name, err);
+		return;
+	}
+
+	parent = fdt_path_offset(fdt, "/soc");
+	if (parent < 0)
+		parent = 0;
+
+	sbi_list_for_each_entry(mtn, &mtn_list, head) {
+		if (!mtn->data.stimecmp_addr)
+			continue;
+
+		err = timer_mtimer_stimer_add_node(fdt, parent, &mtn->data);
+		if (err < 0)
+			sbi_printf("%s: failed to add timer@%lx (error %d)\n",
+				   f->name, mtn->data.stimecmp_addr, err);
+	}
+}
+
+static struct fdt_general_fixup timer_mtimer_stimer = {
+	.name = "aclint-stimer-fixup",
+	.do_fixup = timer_mtimer_stimer_fixup,
+};
+
 static int timer_mtimer_cold_init(const void *fdt, int nodeoff,
 				  const struct fdt_match *match)
 {
@@ -132,6 +266,10 @@ static int timer_mtimer_cold_init(const void *fdt, int nodeoff,
 	if (!mt->hart_count)
 		aclint_mtimer_sync(mt);
 
+	/* Tell the OS about supervisor compare registers it may program */
+	if (mt->stimecmp_addr)
+		fdt_register_general_fixup(&timer_mtimer_stimer);
+
 	sbi_list_add_tail(&mtn->head, &mtn_list);
 	return 0;
 }
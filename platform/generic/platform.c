@@ -11,9 +11,13 @@
 #include <platform_override.h>
 #include <sbi/riscv_asm.h>
 #include <sbi/sbi_bitops.h>
+#include <sbi/sbi_console.h>
+#include <sbi/sbi_domain_context.h>
 #include <sbi/sbi_hartmask.h>
 #include <sbi/sbi_heap.h>
 #include <sbi/sbi_platform.h>
+#include <sbi/sbi_ring.h>
+#include <sbi/sbi_stats.h>
 #include <sbi/sbi_string.h>
 #include <sbi/sbi_system.h>
 #include <sbi/sbi_tlb.h>
@@ -60,14 +64,65 @@ static void fw_platform_lookup_special(const void *fdt, int root_offset)
 	}
 }
 
-static u32 fw_platform_calculate_heap_size(u32 hart_count)
+static int fw_platform_count_domain(void *fdt, int domain_offset,
+				    void *opaque)
 {
-	u32 heap_size;
+	(*(u32 *)opaque)++;
+	return 0;
+}
+
+/* Size of the vector register file saved for each domain context */
+static u32 fw_platform_vregs_size(void)
+{
+#ifdef OPENSBI_CC_SUPPORT_VECTOR
+	unsigned long mstatus, vlenb;
+
+	if (!misa_extension('V'))
+		return 0;
+
+	mstatus = csr_read_set(CSR_MSTATUS, MSTATUS_VS);
+	vlenb = csr_read(CSR_VLENB);
+	csr_write(CSR_MSTATUS, mstatus);
+
+	return 32 * vlenb;
+#else
+	return 0;
+#endif
+}
+
+static u32 fw_platform_calculate_heap_size(const void *fdt, u32 hart_count)
+{
+	u32 heap_size, dom_count = 0;
 
 	heap_size = SBI_PLATFORM_DEFAULT_HEAP_SIZE(hart_count);
 
-	/* For TLB fifo */
-	heap_size += SBI_TLB_INFO_SIZE * (hart_count) * (hart_count);
+	/* For TLB rings, one per sender HART on every receiver HART */
+	heap_size += (SBI_TLB_INFO_SIZE * SBI_TLB_RING_MIN_ENTRIES +
+		      sizeof(struct sbi_ring)) * (hart_count) * (hart_count);
+
+#ifdef CONFIG_SBI_STATS
+	/* For trap and ecall latency histograms */
+	heap_size += SBI_STATS_HART_SIZE * hart_count;
+#endif
+
+	/* For the domain contexts of every HART, root domain included */
+	fdt_iterate_each_domain((void *)fdt, &dom_count,
+				fw_platform_count_domain);
+	if (dom_count) {
+		dom_count++;
+		/* Vector registers */
+		heap_size += fw_platform_vregs_size() * dom_count * hart_count;
+#ifdef CONFIG_SBI_ECALL_OPENSBI_DOMAIN
+		/* Argument buffers, only set through the OpenSBI extension */
+		heap_size += SBI_DOMAIN_CONTEXT_ARGS_MAX * dom_count *
+			     hart_count;
+#endif
+	}
+
+#ifdef CONFIG_CONSOLE_ASYNC
+	/* For buffering console output */
+	heap_size += SBI_CONSOLE_HART_SIZE * hart_count;
+#endif
 
 	return BIT_ALIGN(heap_size, HEAP_BASE_ALIGN);
 }
@@ -91,7 +146,7 @@ static u32 fw_platform_get_heap_size(const void *fdt, u32 hart_count)
 		return BIT_ALIGN(fdt32_to_cpu(*val), HEAP_BASE_ALIGN);
 
 default_config:
-	return fw_platform_calculate_heap_size(hart_count);
+	return fw_platform_calculate_heap_size(fdt, hart_count);
 }
 
 extern struct sbi_platform platform;
@@ -369,6 +424,27 @@ static u64 generic_tlbr_flush_limit(void)
 	return SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT;
 }
 
+static u64 generic_tlbr_flush_limit_override(u32 limit_type)
+{
+	const void *fdt = fdt_get_address();
+	const fdt32_t *val;
+	int offset, len;
+
+	offset = fdt_path_offset(fdt, "/chosen");
+	if (offset < 0)
+		return 0;
+
+	offset = fdt_node_offset_by_compatible(fdt, offset, "opensbi,config");
+	if (offset < 0)
+		return 0;
+
+	val = fdt_getprop(fdt, offset, "tlb-range-flush-limits", &len);
+	if (!val || len < (int)((limit_type + 1) * sizeof(*val)))
+		return 0;
+
+	return fdt32_to_cpu(val[limit_type]);
+}
+
 static u32 generic_tlb_num_entries(void)
 {
 	if (generic_plat && generic_plat->tlb_num_entries)
@@ -438,6 +514,7 @@ const struct sbi_platform_operations platform_ops = {
 	.pmu_init		= generic_pmu_init,
 	.pmu_xlate_to_mhpmevent = generic_pmu_xlate_to_mhpmevent,
 	.get_tlbr_flush_limit	= generic_tlbr_flush_limit,
+	.get_tlbr_flush_limit_override = generic_tlbr_flush_limit_override,
 	.get_tlb_num_entries	= generic_tlb_num_entries,
 	.timer_init		= fdt_timer_init,
 	.mpxy_init		= generic_mpxy_init,